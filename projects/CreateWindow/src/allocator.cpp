@@ -0,0 +1,296 @@
+#include "allocator.h"
+#include "log.h"
+#include <cassert>
+#include <algorithm>
+#include <iostream>
+
+void RangeAllocator::initialize(VkDeviceSize capacity_) {
+	capacity = capacity_;
+	freeSize = capacity_;
+	freeRanges.clear();
+	freeRanges.push_back({ 0, capacity_ });
+}
+
+bool RangeAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+	for (size_t i = 0; i < freeRanges.size(); ++i) {
+		Range range = freeRanges[i];
+		VkDeviceSize alignedOffset = alignUp(range.offset, alignment);
+		VkDeviceSize padding = alignedOffset - range.offset;
+		if (padding + size > range.size) {
+			continue;
+		}
+		// the padding in front stays free, so a later smaller request can still use it
+		VkDeviceSize tailOffset = alignedOffset + size;
+		VkDeviceSize tailSize = range.offset + range.size - tailOffset;
+		if (padding > 0 && tailSize > 0) {
+			freeRanges[i].size = padding;
+			freeRanges.insert(freeRanges.begin() + i + 1, Range{ tailOffset, tailSize });
+		} else if (padding > 0) {
+			freeRanges[i].size = padding;
+		} else if (tailSize > 0) {
+			freeRanges[i] = { tailOffset, tailSize };
+		} else {
+			freeRanges.erase(freeRanges.begin() + i);
+		}
+		freeSize -= size;
+		offset = alignedOffset;
+		return true;
+	}
+	return false;
+}
+
+void RangeAllocator::free(VkDeviceSize offset, VkDeviceSize size) {
+	auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset,
+		[](const Range& range, VkDeviceSize value) { return range.offset < value; });
+	freeSize += size;
+
+	bool mergePrev = next != freeRanges.begin() && (next - 1)->offset + (next - 1)->size == offset;
+	bool mergeNext = next != freeRanges.end() && offset + size == next->offset;
+	if (mergePrev && mergeNext) {
+		(next - 1)->size += size + next->size;
+		freeRanges.erase(next);
+	} else if (mergePrev) {
+		(next - 1)->size += size;
+	} else if (mergeNext) {
+		next->offset = offset;
+		next->size += size;
+	} else {
+		freeRanges.insert(next, Range{ offset, size });
+	}
+}
+
+void DeviceAllocator::initialize(const DeviceInfo& deviceInfo_, VkDevice device_, VkDeviceSize blockSize) {
+	FUNCNAME()
+	deviceInfo = &deviceInfo_;
+	memProperties = &deviceInfo->getMemoryProperties();
+	device = device_;
+	bufferImageGranularity = deviceInfo->getLimits().bufferImageGranularity;
+	nonCoherentAtomSize = deviceInfo->getLimits().nonCoherentAtomSize;
+	maxAllocationCount = deviceInfo->getLimits().maxMemoryAllocationCount;
+
+	// small heaps (e.g. the 256MB BAR heap) would be exhausted by a few full-size blocks
+	for (uint32_t i = 0; i < memProperties->memoryHeapCount; ++i) {
+		VkDeviceSize heapSize = memProperties->memoryHeaps[i].size;
+		blockSizes[i] = heapSize <= 1024ull * 1024 * 1024 ? std::min(blockSize, heapSize / 8) : blockSize;
+	}
+}
+
+void DeviceAllocator::destroy() {
+	FUNCNAME()
+	for (uint32_t i = 0; i < blocks.size(); ++i) {
+		if (blocks[i].memory != VK_NULL_HANDLE) {
+			if (!blocks[i].ranges.isEmpty()) {
+				std::cerr << "DeviceAllocator: block " << i << " still has "
+					<< blocks[i].ranges.getCapacity() - blocks[i].ranges.getFreeSize() << " bytes in use" << std::endl;
+			}
+			destroyBlock(i);
+		}
+	}
+	blocks.clear();
+}
+
+uint32_t DeviceAllocator::createBlock(uint32_t memoryType, AllocationKind kind, VkDeviceSize size, bool dedicated) {
+	if (allocationCount >= maxAllocationCount) {
+		std::cerr << "DeviceAllocator: maxMemoryAllocationCount (" << maxAllocationCount << ") reached" << std::endl;
+		return UINT32_MAX;
+	}
+
+	VkMemoryAllocateInfo allocInfo {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize = size,
+		.memoryTypeIndex = memoryType
+	};
+
+	Block block;
+	VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &block.memory);
+	if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY || result == VK_ERROR_OUT_OF_HOST_MEMORY) {
+		return UINT32_MAX;
+	}
+	if (result != VK_SUCCESS) {
+		assert(0);
+	}
+	++allocationCount;
+	heapUsage[memProperties->memoryTypes[memoryType].heapIndex] += size;
+	block.memoryType = memoryType;
+	block.kind = kind;
+	block.dedicated = dedicated;
+	block.ranges.initialize(size);
+	// host visible blocks stay mapped for their whole lifetime; mapping twice is not allowed anyway
+	if (memProperties->memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		if (vkMapMemory(device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped) != VK_SUCCESS) {
+			assert(0);
+		}
+	}
+
+	for (uint32_t i = 0; i < blocks.size(); ++i) {
+		if (blocks[i].memory == VK_NULL_HANDLE) {
+			blocks[i] = std::move(block);
+			return i;
+		}
+	}
+	blocks.push_back(std::move(block));
+	return static_cast<uint32_t>(blocks.size() - 1);
+}
+
+void DeviceAllocator::destroyBlock(uint32_t blockIndex) {
+	Block& block = blocks[blockIndex];
+	// freeing implicitly unmaps
+	vkFreeMemory(device, block.memory, nullptr);
+	--allocationCount;
+	heapUsage[memProperties->memoryTypes[block.memoryType].heapIndex] -= block.ranges.getCapacity();
+	block = Block();
+}
+
+Allocation DeviceAllocator::allocate(const VkMemoryRequirements& requirements, const MemoryUsage& usage, AllocationKind kind) {
+	Allocation allocation;
+	if (!tryAllocate(requirements, usage, kind, allocation)) {
+		assert(0);
+	}
+	return allocation;
+}
+
+bool DeviceAllocator::tryAllocate(const VkMemoryRequirements& requirements, const MemoryUsage& usage,
+	AllocationKind kind, Allocation& allocation)
+{
+	FUNCNAME()
+	if (bufferImageGranularity <= 1) {
+		// no aliasing hazard, so linear and optimal resources can share blocks
+		kind = AllocationKind::Linear;
+	}
+	uint32_t memoryType = deviceInfo->findMemoryType(requirements.memoryTypeBits, usage);
+	if (memoryType == UINT32_MAX) {
+		return false;
+	}
+	VkDeviceSize blockSize = blockSizes[memProperties->memoryTypes[memoryType].heapIndex];
+
+	uint32_t blockIndex = UINT32_MAX;
+	VkDeviceSize offset = 0;
+	if (requirements.size > blockSize / 2) {
+		blockIndex = createBlock(memoryType, kind, requirements.size, true);
+		if (blockIndex == UINT32_MAX) {
+			return false;
+		}
+		blocks[blockIndex].ranges.allocate(requirements.size, 1, offset);
+	} else {
+		for (uint32_t i = 0; i < blocks.size(); ++i) {
+			Block& block = blocks[i];
+			if (block.memory != VK_NULL_HANDLE && !block.dedicated
+				&& block.memoryType == memoryType && block.kind == kind
+				&& block.ranges.allocate(requirements.size, requirements.alignment, offset)) {
+				blockIndex = i;
+				break;
+			}
+		}
+		if (blockIndex == UINT32_MAX) {
+			blockIndex = createBlock(memoryType, kind, blockSize, false);
+			if (blockIndex == UINT32_MAX) {
+				return false;
+			}
+			blocks[blockIndex].ranges.allocate(requirements.size, requirements.alignment, offset);
+		}
+	}
+
+	const Block& block = blocks[blockIndex];
+	allocation.memory = block.memory;
+	allocation.offset = offset;
+	allocation.size = requirements.size;
+	allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+	allocation.memoryType = memoryType;
+	allocation.block = blockIndex;
+	return true;
+}
+
+void DeviceAllocator::free(Allocation& allocation) {
+	if (allocation.block == UINT32_MAX) {
+		return;
+	}
+	Block& block = blocks[allocation.block];
+	assert(block.memory == allocation.memory);
+	block.ranges.free(allocation.offset, allocation.size);
+	if (block.ranges.isEmpty()) {
+		// keep one empty block per pool around so alloc/free churn doesn't hit the driver
+		bool hasSpare = false;
+		for (uint32_t i = 0; i < blocks.size(); ++i) {
+			const Block& other = blocks[i];
+			if (i != allocation.block && other.memory != VK_NULL_HANDLE && !other.dedicated
+				&& other.memoryType == block.memoryType && other.kind == block.kind && other.ranges.isEmpty()) {
+				hasSpare = true;
+				break;
+			}
+		}
+		if (block.dedicated || hasSpare) {
+			destroyBlock(allocation.block);
+		}
+	}
+	allocation = Allocation();
+}
+
+void DeviceAllocator::enableMemoryBudget(PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2_) {
+	getMemoryProperties2 = getMemoryProperties2_;
+}
+
+DeviceAllocator::HeapBudget DeviceAllocator::getHeapBudget(uint32_t heapIndex) const {
+	if (getMemoryProperties2 == nullptr) {
+		return { memProperties->memoryHeaps[heapIndex].size / 10 * 8, heapUsage[heapIndex] };
+	}
+	// the values change with every allocation in the process, so they are queried each time
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budget {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT
+	};
+	VkPhysicalDeviceMemoryProperties2 properties {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+		.pNext = &budget
+	};
+	getMemoryProperties2(deviceInfo->getPhysicalDevice(), &properties);
+	return { budget.heapBudget[heapIndex], budget.heapUsage[heapIndex] };
+}
+
+bool DeviceAllocator::isCoherent(const Allocation& allocation) const {
+	return (memProperties->memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+}
+
+VkMappedMemoryRange DeviceAllocator::alignedRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const {
+	VkDeviceSize blockCapacity = blocks[allocation.block].ranges.getCapacity();
+	VkDeviceSize begin = allocation.offset + offset;
+	VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+	begin -= begin % nonCoherentAtomSize;
+	end = std::min(alignUp(end, nonCoherentAtomSize), blockCapacity);
+	return VkMappedMemoryRange {
+		.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+		.memory = allocation.memory,
+		.offset = begin,
+		.size = end - begin
+	};
+}
+
+void DeviceAllocator::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+	if (isCoherent(allocation)) {
+		return;
+	}
+	VkMappedMemoryRange range = alignedRange(allocation, offset, size);
+	vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+void DeviceAllocator::invalidate(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+	if (isCoherent(allocation)) {
+		return;
+	}
+	VkMappedMemoryRange range = alignedRange(allocation, offset, size);
+	vkInvalidateMappedMemoryRanges(device, 1, &range);
+}
+
+void DeviceAllocator::printStats() const {
+	std::cout << "DeviceAllocator: " << allocationCount << " vkDeviceMemory allocations"
+		<< (deviceInfo->isUnifiedMemory() ? ", unified memory" : "") << std::endl;
+	for (uint32_t i = 0; i < blocks.size(); ++i) {
+		const Block& block = blocks[i];
+		if (block.memory == VK_NULL_HANDLE) {
+			continue;
+		}
+		std::cout << "\tblock " << i << ": type " << block.memoryType
+			<< (block.kind == AllocationKind::Optimal ? " optimal" : " linear")
+			<< (block.dedicated ? " dedicated" : "")
+			<< ", " << block.ranges.getCapacity() - block.ranges.getFreeSize()
+			<< "/" << block.ranges.getCapacity() << " bytes used" << std::endl;
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+#include "deviceinfo.h"
+
+// alignment must be a power of two, which Vulkan guarantees for every alignment it reports
+inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Hands out aligned [offset, offset + size) ranges from a region of fixed capacity.
+// First fit over a free list kept sorted by offset; neighbours are merged on free.
+class RangeAllocator {
+public:
+	void initialize(VkDeviceSize capacity);
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+	void free(VkDeviceSize offset, VkDeviceSize size);
+	inline VkDeviceSize getCapacity() const { return capacity; }
+	inline VkDeviceSize getFreeSize() const { return freeSize; }
+	inline bool isEmpty() const { return freeSize == capacity; }
+private:
+	struct Range {
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+	std::vector<Range> freeRanges;
+	VkDeviceSize capacity = 0;
+	VkDeviceSize freeSize = 0;
+};
+
+// Buffers and linear images must not share a bufferImageGranularity page with optimal images.
+enum class AllocationKind {
+	Linear,
+	Optimal
+};
+
+// A sub-range of a VkDeviceMemory block. Cheap to copy, owned by whoever created the resource.
+struct Allocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	// persistently mapped pointer to offset, nullptr unless the memory type is HOST_VISIBLE
+	void* mapped = nullptr;
+	uint32_t memoryType = 0;
+	uint32_t block = UINT32_MAX;
+};
+
+// vkAllocateMemory is slow and limited by maxMemoryAllocationCount,
+// so grab large blocks per memory type and sub-allocate resources from them.
+class DeviceAllocator {
+public:
+	static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+	// deviceInfo must outlive the allocator
+	void initialize(const DeviceInfo& deviceInfo, VkDevice device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+	void destroy();
+
+	Allocation allocate(const VkMemoryRequirements& requirements, const MemoryUsage& usage, AllocationKind kind);
+	// false instead of asserting when the device is out of memory or no memory type has usage.required,
+	// so the caller can make room and retry or fall back to another usage
+	bool tryAllocate(const VkMemoryRequirements& requirements, const MemoryUsage& usage, AllocationKind kind,
+		Allocation& allocation);
+	void free(Allocation& allocation);
+
+	// how much of a heap this process may use and does use. With VK_EXT_memory_budget both come from
+	// the driver and include other allocations of the process; without it the budget is 80% of the
+	// heap and the usage counts this allocator's blocks only
+	struct HeapBudget {
+		VkDeviceSize budget;
+		VkDeviceSize usage;
+	};
+	// vkGetPhysicalDeviceMemoryProperties2(KHR), only when VK_EXT_memory_budget is enabled on the device
+	void enableMemoryBudget(PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2);
+	HeapBudget getHeapBudget(uint32_t heapIndex) const;
+	inline uint32_t getHeapIndex(uint32_t memoryType) const { return memProperties->memoryTypes[memoryType].heapIndex; }
+
+	inline const DeviceInfo& getDeviceInfo() const { return *deviceInfo; }
+	inline bool isUnifiedMemory() const { return deviceInfo->isUnifiedMemory(); }
+
+	// no-op for HOST_COHERENT memory; otherwise rounds the range out to nonCoherentAtomSize
+	void flush(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+	void invalidate(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+	bool isCoherent(const Allocation& allocation) const;
+
+	void printStats() const;
+
+private:
+	struct Block {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		uint32_t memoryType = 0;
+		AllocationKind kind = AllocationKind::Linear;
+		bool dedicated = false;
+		void* mapped = nullptr;
+		RangeAllocator ranges;
+	};
+
+	uint32_t createBlock(uint32_t memoryType, AllocationKind kind, VkDeviceSize size, bool dedicated);
+	void destroyBlock(uint32_t blockIndex);
+	VkMappedMemoryRange alignedRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const;
+
+	const DeviceInfo* deviceInfo = nullptr;
+	const VkPhysicalDeviceMemoryProperties* memProperties = nullptr;
+	VkDevice device = VK_NULL_HANDLE;
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+	VkDeviceSize heapUsage[VK_MAX_MEMORY_HEAPS] = {};
+	VkDeviceSize bufferImageGranularity = 1;
+	VkDeviceSize nonCoherentAtomSize = 1;
+	uint32_t maxAllocationCount = 0;
+	uint32_t allocationCount = 0;
+	VkDeviceSize blockSizes[VK_MAX_MEMORY_HEAPS];
+	// indices are handed out in Allocation::block, so destroyed blocks leave a hole to reuse
+	std::vector<Block> blocks;
+};
@@ -3,13 +3,21 @@
 #include "mesh.h"
 #include "log.h"
 #include "utils.h"
+#include "imageloader.h"
 #include <cassert>
 #include <vector>
 #include <set>
 #include <iostream>
 #include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <limits>
+#include <cmath>
+#include <fstream>
 
+#ifdef _MSC_VER
 #pragma comment(lib, "vulkan-1.lib")
+#endif
 
 const std::vector<const char*> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
@@ -19,6 +27,17 @@ const std::vector<const char*> deviceExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+const std::vector<const char*> headlessDeviceExtensions = {};
+
+// per-object constants of every frame in flight live in one persistently mapped ring
+const uint32_t maxUniformObjects = 64;
+const VkDeviceSize maxUniformObjectSize = 256;
+
+const char* pipelineCachePath = "pipeline.cache";
+
+// timestamp pairs per frame: the render pass plus one per mesh
+const uint32_t maxGpuScopes = 16;
+
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 	VkDebugReportFlagsEXT flags,
 	VkDebugReportObjectTypeEXT objType,
@@ -56,6 +75,40 @@ VkResult CreateDebugReportCallbackEXT(
 	}
 }
 
+// a .tiles file as is; for any other image the pyramid next to it, built the first time and
+// rebuilt whenever the existing one doesn't open
+static bool findTilePyramid(const std::string& imagePath, std::string& pyramidPath) {
+	const std::string extension = ".tiles";
+	if (imagePath.size() >= extension.size()
+		&& imagePath.compare(imagePath.size() - extension.size(), extension.size(), extension) == 0) {
+		pyramidPath = imagePath;
+		return true;
+	}
+	pyramidPath = imagePath.substr(0, imagePath.find_last_of('.')) + extension;
+	if (std::ifstream(pyramidPath, std::ios::binary).good()) {
+		if (TilePyramid().open(pyramidPath.c_str())) {
+			return true;
+		}
+		std::cout << "rebuilding " << pyramidPath << std::endl;
+	} else {
+		std::cout << "building " << pyramidPath << std::endl;
+	}
+	if (!buildTilePyramid(imagePath.c_str(), pyramidPath.c_str())) {
+		std::cerr << "cannot build a tile pyramid of " << imagePath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool hasExtension(const std::vector<VkExtensionProperties>& extensions, const char* name) {
+	for (const VkExtensionProperties& extension : extensions) {
+		if (strcmp(extension.extensionName, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void DestroyDebugReportCallbackEXT(
 	VkInstance instance,
 	VkDebugReportCallbackEXT callback,
@@ -67,19 +120,40 @@ void DestroyDebugReportCallbackEXT(
 	}
 }
 
+Application::Application(const AppConfig& config_)
+	: config(config_),
+	framesInFlight(std::clamp(config_.framesInFlight, MIN_FRAMES_IN_FLIGHT, MAX_FRAMES_IN_FLIGHT))
+{
+	// without a window nothing else would ever end the run
+	if (config.headless && config.frameCount == 0) {
+		config.frameCount = 1;
+	}
+	tiledMode = !config.tiledImagePath.empty();
+	// the tiled viewer draws no mesh
+	config.compareVertexLayouts = config.compareVertexLayouts && !tiledMode;
+}
+
 void Application::run() {
 	FUNCNAME()
 	initWindow();
 	initVulkan();
 	mainLoop();
 	destroy();
+	if (!config.tracePath.empty()) {
+		trace::writeChromeJson(config.tracePath);
+	}
 }
 
 void Application::initWindow() {
 	FUNCNAME()
+	if (config.headless) {
+		LOG("- headless: no window")
+		return;
+	}
 	glfwInit();
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	window = glfwCreateWindow(1600, 900, "Title", nullptr, nullptr);
+	window = glfwCreateWindow(static_cast<int>(config.extent.width), static_cast<int>(config.extent.height),
+		"Title", nullptr, nullptr);
 
 	if (glfwVulkanSupported() != GLFW_TRUE) {
 		assert(0);
@@ -90,29 +164,64 @@ void Application::initWindow() {
 	glfwSetWindowSizeCallback(window, Application::onWindowResized);
 }
 
-void Application::onWindowResized(GLFWwindow* window, int width, int height) {
-	static_cast<void>(width);
-	static_cast<void>(height);
+// a drag-resize fires many events per second; only note that one happened and let
+// mainLoop apply it once at a safe point
+void Application::onWindowResized(GLFWwindow* window, int /*width*/, int /*height*/) {
 	Application* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
-	app->recreateSwapChain();
+	app->resizePending = true;
 }
 
 void Application::initVulkan() {
 	FUNCNAME()
+	TRACE_ZONE(TRACE_CATEGORY_INIT, "startup")
+	auto startTime = std::chrono::high_resolution_clock::now();
 	createVkInstance();
 	setupDebugCallback();
 	createSurface();
 	pickPhysicalDevice();
 	createLogicalDevice();
+	allocator.initialize(deviceInfo, device);
+	if (memoryBudgetEnabled) {
+		allocator.enableMemoryBudget(reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+			vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR")));
+	}
+	pipelineCache.initialize(deviceInfo, device, pipelineCachePath);
 	createSwapChain();
+	uniformRing.initialize(deviceInfo, device, allocator,
+		framesInFlight, maxUniformObjects, maxUniformObjectSize);
+	geometryPool.initialize(device, allocator);
 	createImageViews();
 	createRenderPass();
 	createCommandPool();
+	threadPool.initialize();
+	textureLoader.initialize(deviceInfo, device, allocator, threadPool, commandPool, graphicsQueue,
+		framesInFlight, config.textureBudget);
+	if (hostImageCopyEnabled) {
+		hostImageCopy.initialize(instance, physicalDevice, device);
+		textureLoader.enableHostImageCopy(hostImageCopy);
+	}
+	gpuProfiler.initialize(deviceInfo, device,
+		static_cast<uint32_t>(queueFamilies.graphicsFamily), framesInFlight, maxGpuScopes);
+	if (!config.gpuTimingCsvPath.empty()) {
+		gpuProfiler.setCsvPath(config.gpuTimingCsvPath);
+	}
 	createDepthResources();
 	createFramebuffers();
-	create3DModels();
-	createCommandBuffers();
-	createSemaphores();
+	{
+		TRACE_ZONE(TRACE_CATEGORY_INIT, "load models")
+		create3DModels();
+		// a single headless frame would otherwise only ever show the placeholder
+		if (config.headless) {
+			textureLoader.flush();
+		}
+	}
+	createFrameResources();
+	auto endTime = std::chrono::high_resolution_clock::now();
+	std::cout << "startup took " << std::chrono::duration<float, std::milli>(endTime - startTime).count() << " ms ("
+		<< (pipelineCache.isWarm() ? "warm" : "cold") << " pipeline cache)" << std::endl;
+#ifdef _DEBUG
+	allocator.printStats();
+#endif
 }
 
 void Application::mainLoop() {
@@ -123,39 +232,143 @@ void Application::mainLoop() {
 		LOG("- Drawing something...")
 	}
 
-	while (!glfwWindowShouldClose(window)) {
-		glfwPollEvents();
-		drawFrame();
+	uint32_t framesDrawn = 0;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	auto lastFrameTime = startTime;
+	while (config.headless || !glfwWindowShouldClose(window)) {
+		if (config.frameCount > 0 && framesDrawn == config.frameCount) {
+			break;
+		}
+		if (!config.headless) {
+			glfwPollEvents();
+			// an out of date or suboptimal swap chain comes without a resize event, so the size is
+			// always asked for; the window size is in screen coordinates, not pixels
+			if (resizePending) {
+				int width, height;
+				glfwGetFramebufferSize(window, &width, &height);
+				pendingExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+			}
+			// nothing can be presented while minimized, so sleep until the next event instead of spinning
+			bool minimized = glfwGetWindowAttrib(window, GLFW_ICONIFIED) == GLFW_TRUE
+				|| (resizePending && (pendingExtent.width == 0 || pendingExtent.height == 0));
+			if (minimized) {
+				glfwWaitEvents();
+				continue;
+			}
+			if (resizePending) {
+				recreateSwapChain();
+				resizePending = false;
+			}
+			auto now = std::chrono::high_resolution_clock::now();
+			processViewerInput(std::chrono::duration<float>(now - lastFrameTime).count());
+			lastFrameTime = now;
+		}
+		if (drawFrame()) {
+			++framesDrawn;
+		}
 	}
 	vkDeviceWaitIdle(device);
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	if (framesDrawn > 0) {
+		float totalTime = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+		std::cout << framesDrawn << " frames in " << totalTime << " ms, "
+			<< totalTime / framesDrawn << " ms/frame" << std::endl;
+	}
+	gpuProfiler.flush();
+	gpuProfiler.printStats();
+	if (config.headless && !config.readbackPath.empty()) {
+		readbackImage(lastImageIndex, config.readbackPath);
+	}
+}
+
+void Application::processViewerInput(float seconds) {
+	if (!tiledMode) {
+		return;
+	}
+	auto pressed = [this](int key, int alternative) {
+		return glfwGetKey(window, key) == GLFW_PRESS || glfwGetKey(window, alternative) == GLFW_PRESS;
+	};
+	// a screen width per second, and doubling the zoom every half second
+	float step = static_cast<float>(swapChainExtent.width) * seconds;
+	float dx = 0.0f;
+	float dy = 0.0f;
+	if (pressed(GLFW_KEY_LEFT, GLFW_KEY_A)) dx -= step;
+	if (pressed(GLFW_KEY_RIGHT, GLFW_KEY_D)) dx += step;
+	if (pressed(GLFW_KEY_UP, GLFW_KEY_W)) dy -= step;
+	if (pressed(GLFW_KEY_DOWN, GLFW_KEY_S)) dy += step;
+	if (dx != 0.0f || dy != 0.0f) {
+		viewer.pan(dx, dy);
+	}
+	if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
+		viewer.zoom(std::exp2(2.0f * seconds));
+	}
+	if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
+		viewer.zoom(std::exp2(-2.0f * seconds));
+	}
 }
 
 void Application::destroy() {
 	FUNCNAME();
 	cleanupSwapChain();
-	{
+	vkDestroyRenderPass(device, renderPass, nullptr);
+	if (config.headless) {
+		destroyOffscreenImages();
+	} else {
+		vkDestroySwapchainKHR(device, swapChain, nullptr);
+		destroyRenderFinishedSemaphores();
+	}
+	if (!tiledMode) {
 		triangle.destroy();
+		if (config.compareVertexLayouts) {
+			comparisonMesh.destroy();
+		}
 	}
-	vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
-	vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
+	threadPool.destroy();
+	if (tiledMode) {
+		viewer.destroy();
+	}
+	textureLoader.destroy();
+	destroyFrameResources();
+	pipelineCache.save();
+	pipelineCache.destroy();
+	gpuProfiler.destroy();
 	vkDestroyCommandPool(device, commandPool, nullptr);
+	uniformRing.destroy();
+	geometryPool.destroy();
+	allocator.destroy();
 	vkDestroyDevice(device, nullptr);
 	DestroyDebugReportCallbackEXT(instance, callback, nullptr);
-	vkDestroySurfaceKHR(instance, surface, nullptr);
+	if (!config.headless) {
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+	}
 	vkDestroyInstance(instance, nullptr);
-	glfwDestroyWindow(window);
-	glfwTerminate();
+	if (!config.headless) {
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
 }
 
 void Application::getRequiredExtensions(std::vector<const char*>& extensions) {
 	FUNCNAME()
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-	extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	if (!config.headless) {
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions;
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 	if (enableValidationLayers) {
 		extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 	}
+	// optional: needed to query VK_EXT_memory_budget on a Vulkan 1.0 instance
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+	hasPhysicalDeviceProperties2 = hasExtension(availableExtensions, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	if (hasPhysicalDeviceProperties2) {
+		extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
 }
 
 void Application::createVkInstance() {
@@ -232,18 +445,23 @@ QueueFamilyIndices Application::findQueueFamilies(VkPhysicalDevice physDevice) {
 	QueueFamilyIndices indices;
 	uint32_t queueFamilyCount = 0;
 	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &queueFamilyCount, nullptr);
-	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &queueFamilyCount, queueFamilies.data());
+	std::vector<VkQueueFamilyProperties> familyProperties(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &queueFamilyCount, familyProperties.data());
 	int i = 0;
-	for (const auto& queueFamily : queueFamilies) {
+	for (const auto& queueFamily : familyProperties) {
 		if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
 			indices.graphicsFamily = i;
 		}
-		VkBool32 presentSupport = false;
-		LOG("- call vkGetPhysicalDeviceSurfaceSupportKHR() to check present support")
-		vkGetPhysicalDeviceSurfaceSupportKHR(physDevice, i, surface, &presentSupport);
-		if (queueFamily.queueCount > 0 && presentSupport) {
-			indices.presentFamily = i;
+		if (config.headless) {
+			// nothing is presented, the graphics queue stands in for the present queue
+			indices.presentFamily = indices.graphicsFamily;
+		} else {
+			VkBool32 presentSupport = false;
+			LOG("- call vkGetPhysicalDeviceSurfaceSupportKHR() to check present support")
+			vkGetPhysicalDeviceSurfaceSupportKHR(physDevice, i, surface, &presentSupport);
+			if (queueFamily.queueCount > 0 && presentSupport) {
+				indices.presentFamily = i;
+			}
 		}
 		if (indices.isComplete()) {
 			break;
@@ -263,8 +481,8 @@ bool Application::isDeviceSuitable(VkPhysicalDevice physDevice) {
 	vkGetPhysicalDeviceFeatures(physDevice, &deviceFeatures);
 	
 	bool extensionsSupported = checkDeviceExtensionSupport(physDevice);
-	bool swapChainAdequate = false;
-	if (extensionsSupported) {
+	bool swapChainAdequate = config.headless;
+	if (extensionsSupported && !config.headless) {
 		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physDevice);
 		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 	}
@@ -278,7 +496,8 @@ bool Application::checkDeviceExtensionSupport(VkPhysicalDevice physDevice) {
 	vkEnumerateDeviceExtensionProperties(physDevice, nullptr, &extensionCount, nullptr);
 	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
 	vkEnumerateDeviceExtensionProperties(physDevice, nullptr, &extensionCount, availableExtensions.data());
-	std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+	const std::vector<const char*>& extensions = getDeviceExtensions();
+	std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 	for (const auto& extension : availableExtensions) {
 		requiredExtensions.erase(extension.extensionName);
 	}
@@ -303,12 +522,14 @@ void Application::pickPhysicalDevice() {
 	if (physicalDevice == VK_NULL_HANDLE) {
 		assert(0);
 	}
+	deviceInfo.initialize(physicalDevice);
+	queueFamilies = findQueueFamilies(physicalDevice);
 }
 
 void Application::createLogicalDevice() {
 	FUNCNAME()
 	LOG("1. find queue families")
-	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+	const QueueFamilyIndices& indices = queueFamilies;
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<int> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
@@ -324,20 +545,53 @@ void Application::createLogicalDevice() {
 		});
 	}
 
+	const VkPhysicalDeviceFeatures& supportedFeatures = deviceInfo.getFeatures();
+	// BC textures are optional; without the feature Mesh decodes them on the CPU.
+	// Without fullDrawIndexUint32 Mesh splits models whose indices exceed maxDrawIndexedIndexValue
 	VkPhysicalDeviceFeatures deviceFeatures {
-		.samplerAnisotropy = VK_TRUE
+		.fullDrawIndexUint32 = supportedFeatures.fullDrawIndexUint32,
+		.samplerAnisotropy = VK_TRUE,
+		.textureCompressionBC = supportedFeatures.textureCompressionBC
 	};
 
+	// required extensions plus the optional ones this device has
+	std::vector<const char*> enabledExtensions = getDeviceExtensions();
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+	memoryBudgetEnabled = hasPhysicalDeviceProperties2
+		&& hasExtension(availableExtensions, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if (memoryBudgetEnabled) {
+		enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+	hostImageCopyEnabled = config.hostImageCopy && hasPhysicalDeviceProperties2
+		&& HostImageCopy::isSupported(instance, physicalDevice);
+	if (hostImageCopyEnabled) {
+		const std::vector<const char*>& hostImageCopyExtensions = HostImageCopy::getDeviceExtensions();
+		enabledExtensions.insert(enabledExtensions.end(), hostImageCopyExtensions.begin(), hostImageCopyExtensions.end());
+	}
+
 	VkDeviceCreateInfo createInfo{
 		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
 		.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()),
 		.pQueueCreateInfos = queueCreateInfos.data(),
 		.enabledLayerCount = enableValidationLayers ? static_cast<uint32_t>(validationLayers.size()) : 0,
 		.ppEnabledLayerNames = enableValidationLayers ? validationLayers.data() : nullptr,
-		.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
-		.ppEnabledExtensionNames = deviceExtensions.data(),
+		.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size()),
+		.ppEnabledExtensionNames = enabledExtensions.data(),
 		.pEnabledFeatures = &deviceFeatures,
 	};
+#ifdef VK_EXT_host_image_copy
+	VkPhysicalDeviceHostImageCopyFeaturesEXT hostImageCopyFeatures {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT,
+		.pNext = nullptr,
+		.hostImageCopy = VK_TRUE
+	};
+	if (hostImageCopyEnabled) {
+		createInfo.pNext = &hostImageCopyFeatures;
+	}
+#endif
 
 	LOG("2. call vkCreateDevice() with VkPhysicalDevice, VkDeviceCreateInfo to create a VkDevice")
 	if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
@@ -349,8 +603,15 @@ void Application::createLogicalDevice() {
 	vkGetDeviceQueue(device, indices.presentFamily, 0, &presentQueue);
 }
 
+const std::vector<const char*>& Application::getDeviceExtensions() const {
+	return config.headless ? headlessDeviceExtensions : deviceExtensions;
+}
+
 void Application::createSurface() {
 	FUNCNAME()
+	if (config.headless) {
+		return;
+	}
 	LOG("- call glfwCreateWindowSurface() to create a VkSurfaceKHR")
 	if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
 		assert(0);
@@ -404,11 +665,15 @@ VkExtent2D Application::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabil
 	if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
 		return capabilities.currentExtent;
 	} else {
-		int WIDTH, HEIGHT;
-		glfwGetWindowSize(window, &WIDTH, &HEIGHT);
+		// the surface leaves it to the swap chain; pendingExtent is the framebuffer size after a resize
+		VkExtent2D actualExtent = pendingExtent;
+		if (!resizePending) {
+			int WIDTH, HEIGHT;
+			glfwGetFramebufferSize(window, &WIDTH, &HEIGHT);
+			actualExtent = { static_cast<uint32_t>(WIDTH), static_cast<uint32_t>(HEIGHT) };
+		}
 		const auto& minExtent = capabilities.minImageExtent;
 		const auto& maxExtent = capabilities.maxImageExtent;
-		VkExtent2D actualExtent{ static_cast<uint32_t>(WIDTH), static_cast<uint32_t>(HEIGHT) };
 		actualExtent.width = std::max(minExtent.width, std::min(maxExtent.width, actualExtent.width));
 		actualExtent.height = std::max(minExtent.height, std::min(maxExtent.height, actualExtent.height));
 		return actualExtent;
@@ -417,6 +682,10 @@ VkExtent2D Application::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabil
 
 void Application::createSwapChain() {
 	FUNCNAME()
+	if (config.headless) {
+		createOffscreenImages();
+		return;
+	}
 	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
 	VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
@@ -438,7 +707,7 @@ void Application::createSwapChain() {
 		.imageArrayLayers = 1,
 		.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
 	};
-	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+	const QueueFamilyIndices& indices = queueFamilies;
 	uint32_t queueFamilyIndices[] = { static_cast<uint32_t>(indices.graphicsFamily), static_cast<uint32_t>(indices.presentFamily) };
 	if (indices.graphicsFamily != indices.presentFamily) {
 		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
@@ -454,17 +723,25 @@ void Application::createSwapChain() {
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	// lets the presentation engine hand over images still being shown
+	VkSwapchainKHR oldSwapChain = swapChain;
+	createInfo.oldSwapchain = oldSwapChain;
 
 	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
 		assert(0);
 	}
+	if (oldSwapChain != VK_NULL_HANDLE) {
+		vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+	}
 
 	vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
 	swapChainImages.resize(imageCount);
 	vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
 	swapChainImageFormat = surfaceFormat.format;
 	swapChainExtent = extent;
+	// the image count may have changed; the device is idle whenever the swap chain is recreated
+	destroyRenderFinishedSemaphores();
+	createRenderFinishedSemaphores();
 }
 
 void Application::createImageViews() {
@@ -474,7 +751,7 @@ void Application::createImageViews() {
 	for (size_t i = 0; i < swapChainImages.size(); ++i) {
 		swapChainImageViews[i]
 			= createImageView(device, swapChainImages[i], swapChainImageFormat,
-				VK_IMAGE_ASPECT_COLOR_BIT);
+				VK_IMAGE_ASPECT_COLOR_BIT, 1);
 	}
 }
 
@@ -501,10 +778,11 @@ void Application::createRenderPass() {
 	VkSubpassDependency dependency {
 		.srcSubpass = VK_SUBPASS_EXTERNAL,
 		.dstSubpass = 0,
-		.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
 		.srcAccessMask = 0,
 		.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+			| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
 	};
 
 	VkAttachmentDescription attachments[2] {
@@ -517,11 +795,12 @@ void Application::createRenderPass() {
 			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+			// offscreen images are left ready to be copied out
+			.finalLayout = config.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
 		},
 		// depthAttachment
 		{
-			.format = findDepthFormat(physicalDevice),
+			.format = findDepthFormat(deviceInfo),
 			.samples = VK_SAMPLE_COUNT_1_BIT,
 			.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
 			.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
@@ -571,10 +850,11 @@ void Application::createFramebuffers() {
 
 void Application::createCommandPool() {
 	FUNCNAME()
-	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+	const QueueFamilyIndices& queueFamilyIndices = queueFamilies;
+	// command buffers are re-recorded every frame
 	VkCommandPoolCreateInfo poolInfo {
 		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-		.flags = 0,
+		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
 		.queueFamilyIndex = static_cast<uint32_t>(queueFamilyIndices.graphicsFamily)
 	};
 
@@ -585,112 +865,263 @@ void Application::createCommandPool() {
 
 void Application::create3DModels(bool isRecreate) {
 	FUNCNAME()
-	if (isRecreate) {
-		triangle.recreate(swapChainExtent, renderPass);
+	if (tiledMode && !isRecreate) {
+		std::string pyramidPath;
+		tiledMode = findTilePyramid(config.tiledImagePath, pyramidPath)
+			&& viewer.initialize(physicalDevice, device, allocator, uniformRing, threadPool,
+				commandPool, graphicsQueue, pipelineCache.getCache(), renderPass, pyramidPath.c_str());
+		if (!tiledMode) {
+			std::cerr << "cannot view " << config.tiledImagePath << ", drawing the mesh instead" << std::endl;
+		}
+	}
+	if (tiledMode) {
+		if (isRecreate) {
+			viewer.recreate(renderPass);
+		}
+	} else if (isRecreate) {
+		triangle.recreate(renderPass);
+		if (config.compareVertexLayouts) {
+			comparisonMesh.recreate(renderPass);
+		}
 	} else {
-		triangle.initialize(physicalDevice, device,
-			commandPool, graphicsQueue, swapChainExtent, renderPass);
+		// every model records its uploads into one batch, submitted once
+		UploadBatch upload;
+		upload.begin(device, allocator, commandPool, graphicsQueue);
+		triangle.initialize(deviceInfo, device, allocator, uniformRing, geometryPool,
+			upload, textureLoader, pipelineCache.getCache(), renderPass, config.texturePath.c_str(),
+			config.meshPath.c_str(), config.vertexLayout);
+		if (config.compareVertexLayouts) {
+			comparisonMesh.initialize(deviceInfo, device, allocator, uniformRing, geometryPool,
+				upload, textureLoader, pipelineCache.getCache(), renderPass, config.texturePath.c_str(),
+				config.meshPath.c_str(),
+				config.vertexLayout == VertexLayout::Float ? VertexLayout::Packed : VertexLayout::Float);
+		}
+		upload.submit();
+		upload.wait();
 	}
 }
 
-void Application::createCommandBuffers() {
+void Application::createFrameResources() {
 	FUNCNAME()
-	commandBuffers.resize(swapChainFramebuffers.size());
+	frames.resize(framesInFlight);
+	std::vector<VkCommandBuffer> commandBuffers(framesInFlight);
 	VkCommandBufferAllocateInfo allocInfo {
 		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
 		.commandPool = commandPool,
 		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandBufferCount = static_cast<uint32_t>(commandBuffers.size())
+		.commandBufferCount = framesInFlight
 	};
-
 	if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
 		assert(0);
 	}
-	for (size_t i = 0; i < commandBuffers.size(); ++i) {
-		VkCommandBufferBeginInfo beginInfo {
-			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-			.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
-			.pInheritanceInfo = nullptr
-		};
 
-		vkBeginCommandBuffer(commandBuffers[i], &beginInfo);
-
-		VkClearValue clearValues[2] {
-			{
-				.color = { 0.0f, 0.0f, 0.0f, 1.0f }
-			}, 
-			{
-				.depthStencil = { 1.0f, 0 }
-			}
-		};
-
-		VkRenderPassBeginInfo renderPassInfo {
-			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-			.renderPass = renderPass,
-			.framebuffer = swapChainFramebuffers[i],
-			.renderArea {
-				.offset = { 0,0 },
-				.extent = swapChainExtent
-			},
-			.clearValueCount = 2,
-			.pClearValues = clearValues
-		};
-
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		{
-			triangle.commitCommands(commandBuffers[i]);
+	VkSemaphoreCreateInfo semaphoreInfo { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+	// created signaled so the first wait on each frame returns immediately
+	VkFenceCreateInfo fenceInfo {
+		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+		.flags = VK_FENCE_CREATE_SIGNALED_BIT
+	};
+	for (uint32_t i = 0; i < framesInFlight; ++i) {
+		FrameResources& frame = frames[i];
+		frame.commandBuffer = commandBuffers[i];
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &frame.imageAvailableSemaphore) != VK_SUCCESS) {
+			assert(0);
 		}
-		vkCmdEndRenderPass(commandBuffers[i]);
-		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
+		if (vkCreateFence(device, &fenceInfo, nullptr, &frame.inFlightFence) != VK_SUCCESS) {
 			assert(0);
 		}
 	}
+	imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
 }
 
-void Application::createSemaphores() {
+void Application::destroyFrameResources() {
+	FUNCNAME()
+	for (FrameResources& frame : frames) {
+		vkDestroyFence(device, frame.inFlightFence, nullptr);
+		vkDestroySemaphore(device, frame.imageAvailableSemaphore, nullptr);
+		vkFreeCommandBuffers(device, commandPool, 1, &frame.commandBuffer);
+	}
+	frames.clear();
+}
+
+void Application::createRenderFinishedSemaphores() {
 	VkSemaphoreCreateInfo semaphoreInfo { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
-	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS) {
-		assert(0);
+	renderFinishedSemaphores.resize(swapChainImages.size());
+	for (VkSemaphore& semaphore : renderFinishedSemaphores) {
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+			assert(0);
+		}
 	}
-	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS) {
-		assert(0);
+}
+
+void Application::destroyRenderFinishedSemaphores() {
+	for (VkSemaphore semaphore : renderFinishedSemaphores) {
+		vkDestroySemaphore(device, semaphore, nullptr);
 	}
+	renderFinishedSemaphores.clear();
 }
 
-void Application::drawFrame() {
-	// TODO: update logic here
-	triangle.updateUniformBuffer(swapChainExtent);
+void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+	VkCommandBufferBeginInfo beginInfo {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = nullptr
+	};
 
-	vkQueueWaitIdle(presentQueue);
+	vkResetCommandBuffer(commandBuffer, 0);
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	// the fence of currentFrame has signaled, so its previous timings can be read back now
+	gpuProfiler.beginFrame(commandBuffer, currentFrame);
+	uint32_t passScope = gpuProfiler.beginScope(commandBuffer, "render pass");
 
-	// 1. Acquire an image from the swap chain
-	// 2. Execute the command buffer with that image as attachment in the framebuffer
-	// 3. Return the image to the swap chain for presentation
-	uint32_t imageIndex;
-	VkResult result = vkAcquireNextImageKHR(device, swapChain, std::numeric_limits<uint64_t>::max(),
-		imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-		recreateSwapChain();
-		return;
-	} else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+	VkClearValue clearValues[2] {
+		{
+			.color = { 0.0f, 0.0f, 0.0f, 1.0f }
+		}, 
+		{
+			.depthStencil = { 1.0f, 0 }
+		}
+	};
+
+	VkRenderPassBeginInfo renderPassInfo {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+		.renderPass = renderPass,
+		.framebuffer = swapChainFramebuffers[imageIndex],
+		.renderArea {
+			.offset = { 0,0 },
+			.extent = swapChainExtent
+		},
+		.clearValueCount = 2,
+		.pClearValues = clearValues
+	};
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	VkViewport viewport {
+		.x = 0.0f,
+		.y = 0.0f,
+		.width = static_cast<float>(swapChainExtent.width),
+		.height = static_cast<float>(swapChainExtent.height),
+		.minDepth = 0.0f,
+		.maxDepth = 1.0f
+	};
+	VkRect2D scissor {
+		.offset = { 0, 0 },
+		.extent = swapChainExtent
+	};
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	// meshes on the same page of the geometry pool share its bind
+	GeometryBinding geometryBinding;
+	if (config.compareVertexLayouts) {
+		// whichever draws second is mostly rejected by the depth test, so take turns
+		Mesh* floatMesh = config.vertexLayout == VertexLayout::Float ? &triangle : &comparisonMesh;
+		Mesh* packedMesh = floatMesh == &triangle ? &comparisonMesh : &triangle;
+		packedDrawnFirst = !packedDrawnFirst;
+		for (uint32_t i = 0; i < 2; ++i) {
+			bool packed = (i == 0) == packedDrawnFirst;
+			uint32_t meshScope = gpuProfiler.beginScope(commandBuffer,
+				packed ? "mesh: packed vertices" : "mesh: float vertices");
+			(packed ? packedMesh : floatMesh)->commitCommands(commandBuffer, geometryBinding);
+			gpuProfiler.endScope(commandBuffer, meshScope);
+		}
+	} else {
+		uint32_t meshScope = gpuProfiler.beginScope(commandBuffer, tiledMode ? "tiles" : "mesh: triangle");
+		if (tiledMode) {
+			viewer.commitCommands(commandBuffer);
+		} else {
+			triangle.commitCommands(commandBuffer, geometryBinding);
+		}
+		gpuProfiler.endScope(commandBuffer, meshScope);
+	}
+	vkCmdEndRenderPass(commandBuffer);
+	gpuProfiler.endScope(commandBuffer, passScope);
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
 		assert(0);
 	}
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
+}
+
+bool Application::drawFrame() {
+	// 1. Wait until the GPU is done with the resources of this frame slot
+	// 2. Acquire an image from the swap chain
+	// 3. Execute the command buffer with that image as attachment in the framebuffer
+	// 4. Return the image to the swap chain for presentation
+	TRACE_ZONE(TRACE_CATEGORY_FRAME, "drawFrame")
+	FrameResources& frame = frames[currentFrame];
+	{
+		TRACE_ZONE(TRACE_CATEGORY_FRAME, "wait for frame slot")
+		vkWaitForFences(device, 1, &frame.inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+
+	uint32_t imageIndex;
+	VkResult result = VK_SUCCESS;
+	if (config.headless) {
+		// one offscreen image per frame slot, already free once the fence above has signaled
+		imageIndex = currentFrame;
+	} else {
+		TRACE_ZONE(TRACE_CATEGORY_FRAME, "acquire")
+		result = vkAcquireNextImageKHR(device, swapChain, std::numeric_limits<uint64_t>::max(),
+			frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			resizePending = true;
+			return false;
+		} else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+			assert(0);
+		}
+	}
+	lastImageIndex = imageIndex;
+
+	// images can be handed out of order, so an older frame may still be rendering into this one
+	if (imagesInFlight[imageIndex] != VK_NULL_HANDLE && imagesInFlight[imageIndex] != frame.inFlightFence) {
+		vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+	imagesInFlight[imageIndex] = frame.inFlightFence;
+
+	// TODO: update logic here
+	// the fence wait above guarantees the GPU no longer reads this frame's slice
+	{
+		TRACE_ZONE(TRACE_CATEGORY_FRAME, "update and record")
+		textureLoader.update();
+		uniformRing.beginFrame(currentFrame);
+		if (tiledMode) {
+			viewer.update(currentFrame, swapChainExtent);
+		} else {
+			triangle.beginFrame(currentFrame);
+			triangle.updateUniformBuffer(swapChainExtent);
+			if (config.compareVertexLayouts) {
+				comparisonMesh.beginFrame(currentFrame);
+				comparisonMesh.updateUniformBuffer(swapChainExtent);
+			}
+		}
+		uniformRing.endFrame();
+		recordCommandBuffer(frame.commandBuffer, imageIndex);
+	}
+
+	VkSemaphore waitSemaphores[] = { frame.imageAvailableSemaphore };
 	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
+	// headless frames signal nothing, and have no swap chain image to index by
+	VkSemaphore signalSemaphores[] = { config.headless ? VK_NULL_HANDLE : renderFinishedSemaphores[imageIndex] };
 	VkSubmitInfo submitInfo {
 		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.waitSemaphoreCount = 1,
+		.waitSemaphoreCount = config.headless ? 0u : 1u,
 		.pWaitSemaphores = waitSemaphores,
 		.pWaitDstStageMask = waitStages,
 		.commandBufferCount = 1,
-		.pCommandBuffers = &commandBuffers[imageIndex],
-		.signalSemaphoreCount = 1,
+		.pCommandBuffers = &frame.commandBuffer,
+		.signalSemaphoreCount = config.headless ? 0u : 1u,
 		.pSignalSemaphores = signalSemaphores
 	};
 
-	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
-		assert(0);
+	// reset only once work is certain to be submitted, otherwise the next wait would never return
+	vkResetFences(device, 1, &frame.inFlightFence);
+	{
+		TRACE_ZONE(TRACE_CATEGORY_FRAME, "submit")
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, frame.inFlightFence) != VK_SUCCESS) {
+			assert(0);
+		}
+	}
+	if (config.headless) {
+		currentFrame = (currentFrame + 1) % framesInFlight;
+		return true;
 	}
 	VkSwapchainKHR swapChains[] = { swapChain };
 	VkPresentInfoKHR presentInfo {
@@ -703,61 +1134,161 @@ void Application::drawFrame() {
 		.pResults = nullptr
 	};
 
-	result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	{
+		TRACE_ZONE(TRACE_CATEGORY_FRAME, "present")
+		result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	}
+	currentFrame = (currentFrame + 1) % framesInFlight;
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-		recreateSwapChain();
+		resizePending = true;
 	} else if (result != VK_SUCCESS) {
 		assert(0);
 	}
-	vkQueueWaitIdle(presentQueue);
+	return true;
 }
 
 void Application::recreateSwapChain() {
 	FUNCNAME()
-	int width, height;
-	glfwGetWindowSize(window, &width, &height);
-	if (width == 0 || height == 0) return;
+	// mainLoop has just refreshed pendingExtent and doesn't get here while it is 0x0
+	assert(pendingExtent.width != 0 && pendingExtent.height != 0);
+	TRACE_ZONE(TRACE_CATEGORY_INIT, "recreate swap chain")
 	vkDeviceWaitIdle(device);
 	cleanupSwapChain();
+	VkFormat oldFormat = swapChainImageFormat;
 	createSwapChain();
 	createImageViews();
-	createRenderPass();
-	//createGraphicsPipeline();
-	create3DModels(true);
+	// the render pass and the pipelines built against it only depend on the surface format
+	if (swapChainImageFormat != oldFormat) {
+		vkDestroyRenderPass(device, renderPass, nullptr);
+		createRenderPass();
+		create3DModels(true);
+	}
 	createDepthResources();
 	createFramebuffers();
-	createCommandBuffers();
+	imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
 }
 
+// destroys what depends on the swap chain extent; the swap chain itself is handed over
+// to its successor and the render pass is kept across resizes
 void Application::cleanupSwapChain() {
 	FUNCNAME()
 	vkDestroyImageView(device, depthImageView, nullptr);
-	vkDestroyImage(device, depthImage, nullptr);
-	vkFreeMemory(device, depthImageMemory, nullptr);
+	destroyImage(device, allocator, depthImage, depthImageAllocation);
 	for (auto framebuffer : swapChainFramebuffers) {
 		vkDestroyFramebuffer(device, framebuffer, nullptr);
 	}
-	vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-	vkDestroyRenderPass(device, renderPass, nullptr);
 	for (auto imageView : swapChainImageViews) {
 		vkDestroyImageView(device, imageView, nullptr);
 	}
-	vkDestroySwapchainKHR(device, swapChain, nullptr);
 }
 
 void Application::createDepthResources() {
-	VkFormat depthFormat = findDepthFormat(physicalDevice);
-	createImage(physicalDevice, device, swapChainExtent.width, swapChainExtent.height,
+	VkFormat depthFormat = findDepthFormat(deviceInfo);
+	createImage(device, allocator, swapChainExtent.width, swapChainExtent.height, 1,
 		depthFormat,
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		depthImage, depthImageMemory);
+		MemoryClass::DeviceLocal,
+		depthImage, depthImageAllocation);
+	// no explicit transition: the render pass takes the image from UNDEFINED every frame
 	depthImageView = createImageView(device, depthImage, depthFormat,
-		VK_IMAGE_ASPECT_DEPTH_BIT);
-	transitionImageLayout(
-		device, commandPool, graphicsQueue,
-		depthImage, depthFormat,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-}
\ No newline at end of file
+		VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+}
+
+void Application::createOffscreenImages() {
+	FUNCNAME()
+	swapChainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+	swapChainExtent = config.extent;
+	swapChainImages.resize(framesInFlight);
+	offscreenImageAllocations.resize(framesInFlight);
+	for (uint32_t i = 0; i < framesInFlight; ++i) {
+		createImage(device, allocator, swapChainExtent.width, swapChainExtent.height, 1,
+			swapChainImageFormat,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			MemoryClass::DeviceLocal,
+			swapChainImages[i], offscreenImageAllocations[i]);
+	}
+}
+
+void Application::destroyOffscreenImages() {
+	for (size_t i = 0; i < swapChainImages.size(); ++i) {
+		destroyImage(device, allocator, swapChainImages[i], offscreenImageAllocations[i]);
+	}
+	swapChainImages.clear();
+	offscreenImageAllocations.clear();
+}
+
+void Application::readbackImage(uint32_t imageIndex, const std::string& path) {
+	FUNCNAME()
+	VkDeviceSize size = static_cast<VkDeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4;
+	VkBuffer readbackBuffer;
+	Allocation readbackAllocation;
+	// the CPU reads every pixel back, which is slow from uncached memory
+	createBuffer(device, allocator, size,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		MemoryClass::Readback,
+		readbackBuffer, readbackAllocation);
+
+	UploadBatch batch;
+	batch.begin(device, allocator, commandPool, graphicsQueue);
+	// the render pass left the image in TRANSFER_SRC_OPTIMAL; make its color writes visible to the copy
+	VkImageMemoryBarrier barrier {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = swapChainImages[imageIndex],
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+	vkCmdPipelineBarrier(batch.getCommandBuffer(),
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+	VkBufferImageCopy region {
+		.bufferOffset = 0,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.mipLevel = 0,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		},
+		.imageOffset = { 0, 0, 0 },
+		.imageExtent = { swapChainExtent.width, swapChainExtent.height, 1 }
+	};
+	vkCmdCopyImageToBuffer(batch.getCommandBuffer(), swapChainImages[imageIndex],
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+	// make the copy's writes available to the host before mapping the buffer
+	VkBufferMemoryBarrier hostBarrier {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.buffer = readbackBuffer,
+		.offset = 0,
+		.size = VK_WHOLE_SIZE
+	};
+	vkCmdPipelineBarrier(batch.getCommandBuffer(),
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+	batch.submit();
+	batch.wait();
+
+	allocator.invalidate(readbackAllocation);
+	if (freeimage::saveImage(path.c_str(), static_cast<const unsigned char*>(readbackAllocation.mapped),
+		swapChainExtent.width, swapChainExtent.height)) {
+		std::cout << "saved frame to " << path << std::endl;
+	}
+	destroyBuffer(device, allocator, readbackBuffer, readbackAllocation);
+}
@@ -4,8 +4,18 @@
 #include <GLFW/glfw3.h>
 
 #include <vector>
+#include <string>
 
 #include "mesh.h"
+#include "deviceinfo.h"
+#include "allocator.h"
+#include "uniformring.h"
+#include "pipelinecache.h"
+#include "gpuprofiler.h"
+#include "threadpool.h"
+#include "textureloader.h"
+#include "tiledviewer.h"
+#include "hostimagecopy.h"
 
 // vkCreateXXX -> vkDestroyXXX
 // vkAllocateXXX -> vkFreeXXX
@@ -24,16 +34,61 @@ struct SwapChainSupportDetails {
 	std::vector<VkPresentModeKHR> presentModes;
 };
 
+// everything the CPU touches while recording a frame; one set per frame in flight
+struct FrameResources {
+	VkCommandBuffer commandBuffer;
+	VkSemaphore imageAvailableSemaphore;
+	// signaled when the GPU has finished this frame's submission
+	VkFence inFlightFence;
+};
+
+struct AppConfig {
+	// clamped to [Application::MIN_FRAMES_IN_FLIGHT, Application::MAX_FRAMES_IN_FLIGHT]
+	uint32_t framesInFlight = 2;
+	// render into offscreen images: no window, no VkSurfaceKHR, no VK_KHR_swapchain
+	bool headless = false;
+	// size of the offscreen images; a window takes its size from the surface instead
+	VkExtent2D extent = { 1600, 900 };
+	// stop after this many frames, 0 runs until the window is closed (headless runs 1 frame)
+	uint32_t frameCount = 0;
+	// headless only: the last rendered image is saved here when not empty
+	std::string readbackPath;
+	// GPU timings of every frame are written here when not empty
+	std::string gpuTimingCsvPath;
+	// CPU trace zones are written here in the Chrome trace-event format when not empty
+	std::string tracePath;
+	// .ctex (cooked), .dds and .ktx2 are uploaded without decoding, anything else goes through FreeImage
+	std::string texturePath = "../../resources/hob.jpg";
+	// .gltf, .glb or .obj to draw instead of the two quads; a .cmesh cache is written next to it
+	std::string meshPath;
+	// Packed halves the vertex size at the cost of 16-bit positions (within the mesh bounds)
+	VertexLayout vertexLayout = VertexLayout::Float;
+	// draws the mesh in both layouts every frame, each in its own GPU timing scope
+	bool compareVertexLayouts = false;
+	// upload textures with VK_EXT_host_image_copy when the device has it, instead of staging buffers
+	bool hostImageCopy = true;
+	// device memory textures may use, 0 follows VK_EXT_memory_budget (or 80% of the heap without it)
+	VkDeviceSize textureBudget = 0;
+	// when not empty, pans and zooms over this image instead of drawing the mesh.
+	// a .tiles pyramid is viewed as is; any other image gets one built next to it on first use
+	std::string tiledImagePath;
+};
+
 class Application {
 	
 public:
+	explicit Application(const AppConfig& config = AppConfig());
 	void run();
 
+	static constexpr uint32_t MIN_FRAMES_IN_FLIGHT = 2;
+	static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+
 private:
 	void initWindow();
 	void initVulkan();
 	void mainLoop();
-	void drawFrame();
+	// false when no frame was submitted, e.g. the swap chain was out of date
+	bool drawFrame();
 	void destroy();
 
 	static void onWindowResized(GLFWwindow* window, int width, int height);
@@ -58,41 +113,86 @@ private:
 	void createFramebuffers();
 	void createCommandPool();
 	void create3DModels(bool isRecreate = false);
-	void createCommandBuffers();
-	void createSemaphores();
+	void createFrameResources();
+	void destroyFrameResources();
+	void createRenderFinishedSemaphores();
+	void destroyRenderFinishedSemaphores();
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 	void cleanupSwapChain();
 	void recreateSwapChain();
 	void createDepthResources();
+	const std::vector<const char*>& getDeviceExtensions() const;
+	// headless stand-ins for the swap chain images
+	void createOffscreenImages();
+	void destroyOffscreenImages();
+	void readbackImage(uint32_t imageIndex, const std::string& path);
+	// arrows or WASD pan, Q and E zoom; seconds is the time since the last frame
+	void processViewerInput(float seconds);
 
 private:
+	AppConfig config;
 	GLFWwindow* window = nullptr;
 	VkInstance instance;
 	VkDebugReportCallbackEXT callback;
-	VkSurfaceKHR surface;
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	// queried once the device has been picked, shared by everything below
+	DeviceInfo deviceInfo;
+	QueueFamilyIndices queueFamilies;
+	bool hasPhysicalDeviceProperties2 = false;
 	VkDevice device;
+	bool memoryBudgetEnabled = false;
+	bool hostImageCopyEnabled = false;
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
-	VkSwapchainKHR swapChain;
+	DeviceAllocator allocator;
+	UniformRing uniformRing;
+	PipelineCache pipelineCache;
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+	// owned by the swap chain, or by us in headless mode
 	std::vector<VkImage> swapChainImages;
+	std::vector<Allocation> offscreenImageAllocations;
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
 	std::vector<VkImageView> swapChainImageViews;
 	VkRenderPass renderPass;
+	// set by onWindowResized or an out of date swap chain, applied once per frame in mainLoop
+	bool resizePending = false;
+	// framebuffer size the swap chain is recreated with, refreshed by mainLoop while resizePending
+	VkExtent2D pendingExtent {};
 	std::vector<VkFramebuffer> swapChainFramebuffers;
 
 	// depth buffer
 	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
+	Allocation depthImageAllocation;
 	VkImageView depthImageView;
 
 	VkCommandPool commandPool;
-	std::vector<VkCommandBuffer> commandBuffers;
-	VkSemaphore imageAvailableSemaphore;
-	VkSemaphore renderFinishedSemaphore;
+	GpuProfiler gpuProfiler;
+	// decodes textures off the render thread
+	ThreadPool threadPool;
+	HostImageCopy hostImageCopy;
+	TextureLoader textureLoader;
+	uint32_t framesInFlight;
+	uint32_t currentFrame = 0;
+	uint32_t lastImageIndex = 0;
+	std::vector<FrameResources> frames;
+	// fence of the frame that last rendered into each swap chain image
+	std::vector<VkFence> imagesInFlight;
+	// one per swap chain image: present waits on it without a fence, so a per-frame semaphore could
+	// still be pending when its frame slot signals it again. An image is only acquired again once its
+	// present has consumed the wait
+	std::vector<VkSemaphore> renderFinishedSemaphores;
 
 	// 3d models
+	// vertices and indices of every mesh
+	GeometryPool geometryPool;
 	Mesh triangle;
+	// the same mesh in the other vertex layout, only with config.compareVertexLayouts
+	Mesh comparisonMesh;
+	bool packedDrawnFirst = false;
+	bool tiledMode = false;
+	TiledViewer viewer;
 
 #ifdef _DEBUG
 	const bool enableValidationLayers = true;
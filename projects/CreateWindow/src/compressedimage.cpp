@@ -0,0 +1,742 @@
+#include "compressedimage.h"
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+	uint32_t readU32(const unsigned char* p) {
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint64_t readU64(const unsigned char* p) {
+		uint64_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	constexpr uint32_t fourCC(char a, char b, char c, char d) {
+		return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8)
+			| (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+	}
+
+	bool readFile(const char* filename, std::vector<unsigned char>& bytes) {
+		std::ifstream file(filename, std::ios::ate | std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		bytes.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+		return true;
+	}
+
+	size_t levelSize(VkFormat format, uint32_t width, uint32_t height) {
+		return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * compressedBlockSize(format);
+	}
+
+	VkFormat formatFromDxgi(uint32_t dxgiFormat) {
+		switch (dxgiFormat) {
+		case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+		case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+		case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+		case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+		case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+		case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+		case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+		case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	VkFormat formatFromFourCC(uint32_t code) {
+		switch (code) {
+		case fourCC('D', 'X', 'T', '1'): return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case fourCC('D', 'X', 'T', '5'): return VK_FORMAT_BC3_UNORM_BLOCK;
+		case fourCC('A', 'T', 'I', '1'):
+		case fourCC('B', 'C', '4', 'U'): return VK_FORMAT_BC4_UNORM_BLOCK;
+		case fourCC('A', 'T', 'I', '2'):
+		case fourCC('B', 'C', '5', 'U'): return VK_FORMAT_BC5_UNORM_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+		}
+	}
+
+	// rejects empty images and chains longer than a full mip chain before anything is sized from them
+	bool checkExtent(const char* filename, const CompressedImage& image, uint32_t levelCount) {
+		if (image.width == 0 || image.height == 0) {
+			std::cerr << "loadCompressedImage(): " << filename << " has an empty extent" << std::endl;
+			return false;
+		}
+		uint32_t maxLevels = 1;
+		for (uint32_t size = std::max(image.width, image.height); size > 1; size >>= 1) {
+			++maxLevels;
+		}
+		if (levelCount > maxLevels) {
+			std::cerr << "loadCompressedImage(): " << filename << " declares " << levelCount
+				<< " levels, more than its extent allows" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// copies every level of the chain into image.data, largest first
+	bool collectLevels(const char* filename, const std::vector<unsigned char>& bytes,
+		const std::vector<size_t>& fileOffsets, CompressedImage& image)
+	{
+		size_t total = 0;
+		for (uint32_t level = 0; level < fileOffsets.size(); ++level) {
+			uint32_t width = std::max(image.width >> level, 1u);
+			uint32_t height = std::max(image.height >> level, 1u);
+			size_t size = levelSize(image.format, width, height);
+			if (fileOffsets[level] > bytes.size() || bytes.size() - fileOffsets[level] < size) {
+				std::cerr << "loadCompressedImage(): " << filename << " is truncated" << std::endl;
+				return false;
+			}
+			image.levels.push_back({ total, size, width, height });
+			total += size;
+		}
+		image.data.resize(total);
+		for (size_t level = 0; level < image.levels.size(); ++level) {
+			memcpy(image.data.data() + image.levels[level].offset, bytes.data() + fileOffsets[level], image.levels[level].size);
+		}
+		return true;
+	}
+
+	bool loadDDS(const char* filename, const std::vector<unsigned char>& bytes, CompressedImage& image) {
+		const size_t headerSize = 4 + 124;
+		if (bytes.size() < headerSize || readU32(bytes.data() + 4) != 124) {
+			std::cerr << "loadCompressedImage(): " << filename << " has no valid DDS header" << std::endl;
+			return false;
+		}
+		const unsigned char* header = bytes.data() + 4;
+		image.height = readU32(header + 8);
+		image.width = readU32(header + 12);
+		uint32_t mipCount = (readU32(header + 4) & 0x20000) ? std::max(readU32(header + 24), 1u) : 1;
+		uint32_t code = readU32(header + 80);
+		uint32_t caps2 = readU32(header + 108);
+		size_t dataOffset = headerSize;
+
+		if (code == fourCC('D', 'X', '1', '0')) {
+			if (bytes.size() < headerSize + 20) {
+				std::cerr << "loadCompressedImage(): " << filename << " has a truncated DX10 header" << std::endl;
+				return false;
+			}
+			const unsigned char* dx10 = bytes.data() + headerSize;
+			image.format = formatFromDxgi(readU32(dx10));
+			// resourceDimension 3 is TEXTURE2D; miscFlag 0x4 marks a cube map
+			if (readU32(dx10 + 4) != 3 || (readU32(dx10 + 8) & 0x4) || readU32(dx10 + 12) > 1) {
+				std::cerr << "loadCompressedImage(): " << filename << " is not a single 2D texture" << std::endl;
+				return false;
+			}
+			dataOffset += 20;
+		} else {
+			image.format = formatFromFourCC(code);
+		}
+		if (caps2 & 0x200) {
+			std::cerr << "loadCompressedImage(): " << filename << " is a cube map" << std::endl;
+			return false;
+		}
+		if (image.format == VK_FORMAT_UNDEFINED) {
+			std::cerr << "loadCompressedImage(): " << filename << " is not BC1/BC3/BC4/BC5/BC7" << std::endl;
+			return false;
+		}
+		if (!checkExtent(filename, image, mipCount)) {
+			return false;
+		}
+
+		std::vector<size_t> fileOffsets(mipCount);
+		for (uint32_t level = 0; level < mipCount; ++level) {
+			fileOffsets[level] = dataOffset;
+			dataOffset += levelSize(image.format, std::max(image.width >> level, 1u), std::max(image.height >> level, 1u));
+		}
+		return collectLevels(filename, bytes, fileOffsets, image);
+	}
+
+	bool loadKTX2(const char* filename, const std::vector<unsigned char>& bytes, CompressedImage& image) {
+		const size_t headerSize = 80;
+		if (bytes.size() < headerSize) {
+			std::cerr << "loadCompressedImage(): " << filename << " has no valid KTX2 header" << std::endl;
+			return false;
+		}
+		const unsigned char* header = bytes.data() + 12;
+		image.format = static_cast<VkFormat>(readU32(header));
+		image.width = readU32(header + 8);
+		image.height = readU32(header + 12);
+		uint32_t depth = readU32(header + 16);
+		uint32_t layerCount = readU32(header + 20);
+		uint32_t faceCount = readU32(header + 24);
+		// 0 asks the loader to generate mips, which compressed data can't do
+		uint32_t levelCount = std::max(readU32(header + 28), 1u);
+		uint32_t supercompression = readU32(header + 32);
+
+		if (compressedBlockSize(image.format) == 0) {
+			std::cerr << "loadCompressedImage(): " << filename << " is not BC1/BC3/BC4/BC5/BC7" << std::endl;
+			return false;
+		}
+		if (depth > 1 || layerCount > 1 || faceCount != 1 || supercompression != 0) {
+			std::cerr << "loadCompressedImage(): " << filename
+				<< " must be a single 2D texture without supercompression" << std::endl;
+			return false;
+		}
+		if (!checkExtent(filename, image, levelCount)) {
+			return false;
+		}
+		if (bytes.size() < headerSize + static_cast<size_t>(levelCount) * 24) {
+			std::cerr << "loadCompressedImage(): " << filename << " has a truncated level index" << std::endl;
+			return false;
+		}
+
+		std::vector<size_t> fileOffsets(levelCount);
+		for (uint32_t level = 0; level < levelCount; ++level) {
+			const unsigned char* entry = bytes.data() + headerSize + static_cast<size_t>(level) * 24;
+			uint64_t byteOffset = readU64(entry);
+			uint64_t byteLength = readU64(entry + 8);
+			size_t expected = levelSize(image.format, std::max(image.width >> level, 1u), std::max(image.height >> level, 1u));
+			if (byteLength != expected) {
+				std::cerr << "loadCompressedImage(): " << filename << " has an unexpected size for level " << level << std::endl;
+				return false;
+			}
+			fileOffsets[level] = static_cast<size_t>(byteOffset);
+		}
+		return collectLevels(filename, bytes, fileOffsets, image);
+	}
+
+	void expand565(uint16_t color, unsigned char rgb[3]) {
+		rgb[0] = static_cast<unsigned char>((((color >> 11) & 31) * 255 + 15) / 31);
+		rgb[1] = static_cast<unsigned char>((((color >> 5) & 63) * 255 + 31) / 63);
+		rgb[2] = static_cast<unsigned char>(((color & 31) * 255 + 15) / 31);
+	}
+
+	// BC1 color block into 16 RGBA texels; BC3 always uses the four color mode
+	void decodeColorBlock(const unsigned char* block, bool punchThrough, unsigned char texels[16][4]) {
+		uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+		uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+		unsigned char palette[4][4];
+		expand565(c0, palette[0]);
+		expand565(c1, palette[1]);
+		palette[0][3] = palette[1][3] = 255;
+		bool fourColors = c0 > c1 || !punchThrough;
+		for (int c = 0; c < 3; ++c) {
+			if (fourColors) {
+				palette[2][c] = static_cast<unsigned char>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+				palette[3][c] = static_cast<unsigned char>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+			} else {
+				palette[2][c] = static_cast<unsigned char>((palette[0][c] + palette[1][c] + 1) / 2);
+				palette[3][c] = 0;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = fourColors ? 255 : 0;
+
+		uint32_t indices = readU32(block + 4);
+		for (int i = 0; i < 16; ++i) {
+			memcpy(texels[i], palette[(indices >> (i * 2)) & 3], 4);
+		}
+	}
+
+	// BC3 alpha / BC4 / BC5 channel block into 16 values
+	void decodeChannelBlock(const unsigned char* block, unsigned char values[16]) {
+		unsigned char palette[8];
+		palette[0] = block[0];
+		palette[1] = block[1];
+		if (palette[0] > palette[1]) {
+			for (int i = 1; i < 7; ++i) {
+				palette[i + 1] = static_cast<unsigned char>(((7 - i) * palette[0] + i * palette[1] + 3) / 7);
+			}
+		} else {
+			for (int i = 1; i < 5; ++i) {
+				palette[i + 1] = static_cast<unsigned char>(((5 - i) * palette[0] + i * palette[1] + 2) / 5);
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; ++i) {
+			indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+		}
+		for (int i = 0; i < 16; ++i) {
+			values[i] = palette[(indices >> (i * 3)) & 7];
+		}
+	}
+
+	// BC4 / BC5 signed channel block into 16 values; -128 decodes like -127
+	void decodeSignedChannelBlock(const unsigned char* block, signed char values[16]) {
+		auto divide = [](int value, int divisor) {
+			return value >= 0 ? (value + divisor / 2) / divisor : -((divisor / 2 - value) / divisor);
+		};
+		int palette[8];
+		palette[0] = std::max(static_cast<int>(static_cast<signed char>(block[0])), -127);
+		palette[1] = std::max(static_cast<int>(static_cast<signed char>(block[1])), -127);
+		if (palette[0] > palette[1]) {
+			for (int i = 1; i < 7; ++i) {
+				palette[i + 1] = divide((7 - i) * palette[0] + i * palette[1], 7);
+			}
+		} else {
+			for (int i = 1; i < 5; ++i) {
+				palette[i + 1] = divide((5 - i) * palette[0] + i * palette[1], 5);
+			}
+			palette[6] = -127;
+			palette[7] = 127;
+		}
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; ++i) {
+			indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+		}
+		for (int i = 0; i < 16; ++i) {
+			values[i] = static_cast<signed char>(palette[(indices >> (i * 3)) & 7]);
+		}
+	}
+
+	// BC7 fields are packed least significant bit first
+	class BitReader {
+	public:
+		explicit BitReader(const unsigned char* data_) : data(data_) {}
+		uint32_t read(uint32_t count) {
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < count; ++i, ++position) {
+				value |= ((data[position >> 3] >> (position & 7)) & 1u) << i;
+			}
+			return value;
+		}
+
+	private:
+		const unsigned char* data;
+		uint32_t position = 0;
+	};
+
+	struct BC7Mode {
+		uint32_t subsets;
+		uint32_t partitionBits;
+		uint32_t rotationBits;
+		uint32_t indexSelectionBits;
+		uint32_t colorBits;
+		uint32_t alphaBits;
+		// one p-bit per endpoint, or one shared by both endpoints of a subset
+		uint32_t endpointPBits;
+		uint32_t sharedPBits;
+		uint32_t indexBits;
+		uint32_t secondaryIndexBits;
+	};
+
+	const BC7Mode bc7Modes[8] = {
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+	};
+
+	// bit i set: texel i belongs to the second subset
+	const uint16_t bc7Partitions2[64] = {
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+		0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+		0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+		0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+		0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+	};
+
+	// two bits per texel, texel 0 in the lowest bits
+	const uint32_t bc7Partitions3[64] = {
+		0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+		0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+		0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+		0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+		0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+		0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+		0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+		0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
+	};
+
+	// texels whose index drops its top bit: texel 0 for the first subset and these for the others
+	const unsigned char bc7Anchors2[64] = {
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+		15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+		6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+	};
+	const unsigned char bc7Anchors3Second[64] = {
+		3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+		3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+		8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+		3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3
+	};
+	const unsigned char bc7Anchors3Third[64] = {
+		15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+		15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+		15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+		15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8
+	};
+
+	uint32_t bc7Interpolate(uint32_t e0, uint32_t e1, uint32_t index, uint32_t indexBits) {
+		static const uint32_t weights2[4] = { 0, 21, 43, 64 };
+		static const uint32_t weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+		static const uint32_t weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		uint32_t weight = indexBits == 2 ? weights2[index] : indexBits == 3 ? weights3[index] : weights4[index];
+		return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+	}
+
+	// endpoint of precision bits to 8 bits, the top bits repeated below
+	uint32_t bc7Expand(uint32_t value, uint32_t precision) {
+		value <<= 8 - precision;
+		return value | (value >> precision);
+	}
+
+	// BC7 block into 16 RGBA texels
+	void decodeBC7Block(const unsigned char* block, unsigned char texels[16][4]) {
+		uint32_t modeIndex = 0;
+		while (modeIndex < 8 && (block[0] & (1u << modeIndex)) == 0) {
+			++modeIndex;
+		}
+		// the reserved mode decodes to transparent black
+		if (modeIndex == 8) {
+			memset(texels, 0, 16 * 4);
+			return;
+		}
+		const BC7Mode& mode = bc7Modes[modeIndex];
+		BitReader bits(block);
+		bits.read(modeIndex + 1);
+		uint32_t partition = bits.read(mode.partitionBits);
+		uint32_t rotation = bits.read(mode.rotationBits);
+		uint32_t indexSelection = bits.read(mode.indexSelectionBits);
+
+		// endpoints[subset * 2 + end] as R, G, B, A
+		uint32_t endpoints[6][4];
+		uint32_t endpointCount = mode.subsets * 2;
+		for (uint32_t c = 0; c < 3; ++c) {
+			for (uint32_t e = 0; e < endpointCount; ++e) {
+				endpoints[e][c] = bits.read(mode.colorBits);
+			}
+		}
+		for (uint32_t e = 0; e < endpointCount; ++e) {
+			endpoints[e][3] = bits.read(mode.alphaBits);
+		}
+		uint32_t colorPrecision = mode.colorBits;
+		uint32_t alphaPrecision = mode.alphaBits;
+		if (mode.endpointPBits != 0 || mode.sharedPBits != 0) {
+			uint32_t pBits[6];
+			for (uint32_t e = 0; e < endpointCount; ++e) {
+				pBits[e] = mode.endpointPBits != 0 || e % 2 == 0 ? bits.read(1) : pBits[e - 1];
+			}
+			for (uint32_t e = 0; e < endpointCount; ++e) {
+				for (uint32_t c = 0; c < 4; ++c) {
+					endpoints[e][c] = (endpoints[e][c] << 1) | pBits[e];
+				}
+			}
+			++colorPrecision;
+			alphaPrecision += mode.alphaBits != 0 ? 1 : 0;
+		}
+		for (uint32_t e = 0; e < endpointCount; ++e) {
+			for (uint32_t c = 0; c < 3; ++c) {
+				endpoints[e][c] = bc7Expand(endpoints[e][c], colorPrecision);
+			}
+			endpoints[e][3] = mode.alphaBits != 0 ? bc7Expand(endpoints[e][3], alphaPrecision) : 255;
+		}
+
+		uint32_t subsetOf[16];
+		uint32_t anchors[3] = { 0, 0, 0 };
+		for (uint32_t i = 0; i < 16; ++i) {
+			subsetOf[i] = mode.subsets == 2 ? (bc7Partitions2[partition] >> i) & 1
+				: mode.subsets == 3 ? (bc7Partitions3[partition] >> (i * 2)) & 3 : 0;
+		}
+		if (mode.subsets == 2) {
+			anchors[1] = bc7Anchors2[partition];
+		} else if (mode.subsets == 3) {
+			anchors[1] = bc7Anchors3Second[partition];
+			anchors[2] = bc7Anchors3Third[partition];
+		}
+		uint32_t indices[16];
+		for (uint32_t i = 0; i < 16; ++i) {
+			indices[i] = bits.read(mode.indexBits - (i == anchors[subsetOf[i]] ? 1 : 0));
+		}
+		uint32_t secondaryIndices[16] = {};
+		if (mode.secondaryIndexBits != 0) {
+			for (uint32_t i = 0; i < 16; ++i) {
+				secondaryIndices[i] = bits.read(mode.secondaryIndexBits - (i == 0 ? 1 : 0));
+			}
+		}
+
+		for (uint32_t i = 0; i < 16; ++i) {
+			const uint32_t* e0 = endpoints[subsetOf[i] * 2];
+			const uint32_t* e1 = endpoints[subsetOf[i] * 2 + 1];
+			// modes 4 and 5 carry a second index set; mode 4 picks which of the two the color uses
+			uint32_t colorIndex = indices[i];
+			uint32_t colorIndexBits = mode.indexBits;
+			uint32_t alphaIndex = indices[i];
+			uint32_t alphaIndexBits = mode.indexBits;
+			if (mode.secondaryIndexBits != 0) {
+				if (indexSelection != 0) {
+					colorIndex = secondaryIndices[i];
+					colorIndexBits = mode.secondaryIndexBits;
+				} else {
+					alphaIndex = secondaryIndices[i];
+					alphaIndexBits = mode.secondaryIndexBits;
+				}
+			}
+			uint32_t texel[4];
+			for (uint32_t c = 0; c < 3; ++c) {
+				texel[c] = bc7Interpolate(e0[c], e1[c], colorIndex, colorIndexBits);
+			}
+			texel[3] = bc7Interpolate(e0[3], e1[3], alphaIndex, alphaIndexBits);
+			// rotation 1, 2, 3 swaps alpha with red, green, blue
+			if (rotation != 0) {
+				std::swap(texel[3], texel[rotation - 1]);
+			}
+			for (uint32_t c = 0; c < 4; ++c) {
+				texels[i][c] = static_cast<unsigned char>(texel[c]);
+			}
+		}
+	}
+
+}
+
+bool isCompressedImageFile(const char* filename) {
+	const char* extension = strrchr(filename, '.');
+	if (!extension) {
+		return false;
+	}
+	std::string lower(extension);
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+	return lower == ".dds" || lower == ".ktx2";
+}
+
+bool loadCompressedImage(const char* filename, CompressedImage& image) {
+	image = CompressedImage();
+	std::vector<unsigned char> bytes;
+	if (!readFile(filename, bytes)) {
+		std::cerr << "Error loading: " << filename << std::endl;
+		return false;
+	}
+	static const unsigned char ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	if (bytes.size() >= 12 && memcmp(bytes.data(), ktx2Identifier, 12) == 0) {
+		return loadKTX2(filename, bytes, image);
+	}
+	if (bytes.size() >= 4 && readU32(bytes.data()) == fourCC('D', 'D', 'S', ' ')) {
+		return loadDDS(filename, bytes, image);
+	}
+	std::cerr << "loadCompressedImage(): " << filename << " is neither DDS nor KTX2" << std::endl;
+	return false;
+}
+
+uint32_t compressedBlockSize(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+		return 8;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+VkFormat decompressedFormat(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		return VK_FORMAT_B8G8R8A8_UNORM;
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return VK_FORMAT_B8G8R8A8_SRGB;
+	// keeps the values signed; B8G8R8A8_SNORM is not guaranteed to be sampleable
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+		return VK_FORMAT_R8G8B8A8_SNORM;
+	default:
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
+bool decompressLevel(VkFormat format, const unsigned char* blocks, uint32_t width, uint32_t height, unsigned char* pixels) {
+	VkFormat outputFormat = decompressedFormat(format);
+	if (outputFormat == VK_FORMAT_UNDEFINED) {
+		return false;
+	}
+	bool swapRedBlue = outputFormat != VK_FORMAT_R8G8B8A8_SNORM;
+	uint32_t blockSize = compressedBlockSize(format);
+	bool rgbOnly = format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+	for (uint32_t by = 0; by < height; by += 4) {
+		for (uint32_t bx = 0; bx < width; bx += 4, blocks += blockSize) {
+			// texels as R, G, B, A
+			unsigned char texels[16][4];
+			switch (format) {
+			case VK_FORMAT_BC4_UNORM_BLOCK: {
+				unsigned char red[16];
+				decodeChannelBlock(blocks, red);
+				for (int i = 0; i < 16; ++i) {
+					texels[i][0] = red[i];
+					texels[i][1] = texels[i][2] = 0;
+					texels[i][3] = 255;
+				}
+				break;
+			}
+			case VK_FORMAT_BC4_SNORM_BLOCK: {
+				signed char red[16];
+				decodeSignedChannelBlock(blocks, red);
+				for (int i = 0; i < 16; ++i) {
+					texels[i][0] = static_cast<unsigned char>(red[i]);
+					texels[i][1] = texels[i][2] = 0;
+					texels[i][3] = 127;
+				}
+				break;
+			}
+			case VK_FORMAT_BC5_SNORM_BLOCK: {
+				signed char red[16], green[16];
+				decodeSignedChannelBlock(blocks, red);
+				decodeSignedChannelBlock(blocks + 8, green);
+				for (int i = 0; i < 16; ++i) {
+					texels[i][0] = static_cast<unsigned char>(red[i]);
+					texels[i][1] = static_cast<unsigned char>(green[i]);
+					texels[i][2] = 0;
+					texels[i][3] = 127;
+				}
+				break;
+			}
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+			case VK_FORMAT_BC7_SRGB_BLOCK:
+				decodeBC7Block(blocks, texels);
+				break;
+			case VK_FORMAT_BC5_UNORM_BLOCK: {
+				unsigned char red[16], green[16];
+				decodeChannelBlock(blocks, red);
+				decodeChannelBlock(blocks + 8, green);
+				for (int i = 0; i < 16; ++i) {
+					texels[i][0] = red[i];
+					texels[i][1] = green[i];
+					texels[i][2] = 0;
+					texels[i][3] = 255;
+				}
+				break;
+			}
+			case VK_FORMAT_BC3_UNORM_BLOCK:
+			case VK_FORMAT_BC3_SRGB_BLOCK: {
+				unsigned char alpha[16];
+				decodeChannelBlock(blocks, alpha);
+				decodeColorBlock(blocks + 8, false, texels);
+				for (int i = 0; i < 16; ++i) {
+					texels[i][3] = alpha[i];
+				}
+				break;
+			}
+			default:
+				decodeColorBlock(blocks, true, texels);
+				if (rgbOnly) {
+					for (int i = 0; i < 16; ++i) {
+						texels[i][3] = 255;
+					}
+				}
+				break;
+			}
+
+			// blocks on the right and bottom edge may hang over the image
+			for (uint32_t y = 0; y < 4 && by + y < height; ++y) {
+				for (uint32_t x = 0; x < 4 && bx + x < width; ++x) {
+					const unsigned char* texel = texels[y * 4 + x];
+					unsigned char* out = pixels + (static_cast<size_t>(by + y) * width + bx + x) * 4;
+					out[0] = texel[swapRedBlue ? 2 : 0];
+					out[1] = texel[1];
+					out[2] = texel[swapRedBlue ? 0 : 2];
+					out[3] = texel[3];
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void compressLevelBC1(const unsigned char* bgra, uint32_t width, uint32_t height, unsigned char* blocks) {
+	for (uint32_t by = 0; by < height; by += 4) {
+		for (uint32_t bx = 0; bx < width; bx += 4, blocks += 8) {
+			// texels as R, G, B; blocks hanging over the edge repeat the last row and column
+			int texels[16][3];
+			int minColor[3] = { 255, 255, 255 };
+			int maxColor[3] = { 0, 0, 0 };
+			for (uint32_t i = 0; i < 16; ++i) {
+				uint32_t x = std::min(bx + i % 4, width - 1);
+				uint32_t y = std::min(by + i / 4, height - 1);
+				const unsigned char* texel = bgra + (static_cast<size_t>(y) * width + x) * 4;
+				texels[i][0] = texel[2];
+				texels[i][1] = texel[1];
+				texels[i][2] = texel[0];
+				for (int c = 0; c < 3; ++c) {
+					minColor[c] = std::min(minColor[c], texels[i][c]);
+					maxColor[c] = std::max(maxColor[c], texels[i][c]);
+				}
+			}
+			// endpoints on the bounding box diagonal, inset a little to spend the palette on the interior
+			for (int c = 0; c < 3; ++c) {
+				int inset = (maxColor[c] - minColor[c]) / 16;
+				minColor[c] += inset;
+				maxColor[c] -= inset;
+			}
+			auto pack565 = [](const int color[3]) {
+				return static_cast<uint16_t>(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+			};
+			uint16_t c0 = pack565(maxColor);
+			uint16_t c1 = pack565(minColor);
+			if (c0 < c1) {
+				std::swap(c0, c1);
+			}
+			uint32_t indices = 0;
+			if (c0 != c1) {
+				// the decoder's palette, so the choice matches what will be sampled
+				unsigned char palette[4][3];
+				expand565(c0, palette[0]);
+				expand565(c1, palette[1]);
+				for (int c = 0; c < 3; ++c) {
+					palette[2][c] = static_cast<unsigned char>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+					palette[3][c] = static_cast<unsigned char>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+				}
+				for (uint32_t i = 0; i < 16; ++i) {
+					int best = 0;
+					int bestDistance = INT32_MAX;
+					for (int p = 0; p < 4; ++p) {
+						int distance = 0;
+						for (int c = 0; c < 3; ++c) {
+							int d = texels[i][c] - palette[p][c];
+							distance += d * d;
+						}
+						if (distance < bestDistance) {
+							bestDistance = distance;
+							best = p;
+						}
+					}
+					indices |= static_cast<uint32_t>(best) << (i * 2);
+				}
+			}
+			blocks[0] = static_cast<unsigned char>(c0 & 0xFF);
+			blocks[1] = static_cast<unsigned char>(c0 >> 8);
+			blocks[2] = static_cast<unsigned char>(c1 & 0xFF);
+			blocks[3] = static_cast<unsigned char>(c1 >> 8);
+			memcpy(blocks + 4, &indices, sizeof(indices));
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstddef>
+
+// Pre-compressed BC1/BC3/BC4/BC5/BC7 textures with their mip chain, read from DDS or KTX2.
+// Levels are stored back to back in data, largest first, exactly as vkCmdCopyBufferToImage wants them.
+struct CompressedImage {
+	struct Level {
+		size_t offset;
+		size_t size;
+		uint32_t width;
+		uint32_t height;
+	};
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<Level> levels;
+	std::vector<unsigned char> data;
+};
+
+// true for .dds and .ktx2 file names
+bool isCompressedImageFile(const char* filename);
+
+// 2D, single layer, no supercompression; anything else is rejected with a message
+bool loadCompressedImage(const char* filename, CompressedImage& image);
+
+// bytes per 4x4 block, 0 for formats this loader doesn't handle
+uint32_t compressedBlockSize(VkFormat format);
+
+// format the CPU fallback decodes to: VK_FORMAT_B8G8R8A8_UNORM or _SRGB, VK_FORMAT_R8G8B8A8_SNORM
+// for signed BC4/BC5, VK_FORMAT_UNDEFINED for formats this loader doesn't handle
+VkFormat decompressedFormat(VkFormat format);
+
+// decodes one level into tightly packed texels of decompressedFormat(format);
+// pixels must hold width * height * 4 bytes
+bool decompressLevel(VkFormat format, const unsigned char* blocks, uint32_t width, uint32_t height, unsigned char* pixels);
+
+// encodes tightly packed BGRA texels as opaque BC1 blocks, used offline by the texture cooker;
+// blocks must hold ceil(width / 4) * ceil(height / 4) * 8 bytes
+void compressLevelBC1(const unsigned char* bgra, uint32_t width, uint32_t height, unsigned char* blocks);
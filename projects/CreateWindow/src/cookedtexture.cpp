@@ -0,0 +1,119 @@
+#include "cookedtexture.h"
+#include "imagefilter.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+namespace {
+
+	uint64_t alignOffset(uint64_t offset) {
+		return (offset + COOKED_TEXTURE_ALIGNMENT - 1) & ~static_cast<uint64_t>(COOKED_TEXTURE_ALIGNMENT - 1);
+	}
+
+	// bytes of one level: BC blocks or 4 bytes per texel
+	uint64_t levelSize(VkFormat format, uint32_t width, uint32_t height) {
+		uint32_t blockSize = compressedBlockSize(format);
+		if (blockSize != 0) {
+			return static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+		}
+		return static_cast<uint64_t>(width) * height * 4;
+	}
+
+	bool isSupportedFormat(VkFormat format) {
+		return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB
+			|| compressedBlockSize(format) != 0;
+	}
+
+}
+
+bool isCookedTextureFile(const char* filename) {
+	size_t length = strlen(filename);
+	return length >= 5 && strcmp(filename + length - 5, ".ctex") == 0;
+}
+
+bool parseCookedTexture(const unsigned char* data, size_t size, CookedTexture& texture) {
+	texture = CookedTexture();
+	CookedTextureHeader header;
+	if (size < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != COOKED_TEXTURE_MAGIC || header.version != COOKED_TEXTURE_VERSION) {
+		std::cerr << "parseCookedTexture(): not a version " << COOKED_TEXTURE_VERSION << " cooked texture" << std::endl;
+		return false;
+	}
+	VkFormat format = static_cast<VkFormat>(header.format);
+	if (!isSupportedFormat(format) || header.levelCount == 0 || header.levelCount > 32
+		|| size < sizeof(header) + header.levelCount * sizeof(CookedTextureLevel)) {
+		return false;
+	}
+	if (header.width == 0 || header.height == 0 || header.levelCount > mipLevelCount(header.width, header.height)) {
+		std::cerr << "parseCookedTexture(): the extent or level count is corrupt" << std::endl;
+		return false;
+	}
+	texture.format = format;
+	texture.width = header.width;
+	texture.height = header.height;
+	for (uint32_t i = 0; i < header.levelCount; ++i) {
+		CookedTextureLevel level;
+		memcpy(&level, data + sizeof(header) + i * sizeof(level), sizeof(level));
+		if (level.width != std::max(header.width >> i, 1u) || level.height != std::max(header.height >> i, 1u)
+			|| level.size != levelSize(format, level.width, level.height)
+			|| level.offset % COOKED_TEXTURE_ALIGNMENT != 0
+			|| level.offset > size || size - level.offset < level.size
+			// the loader stages the chain as one range from the first level to the end of the last
+			|| (i > 0 && level.offset < texture.levels.back().offset + texture.levels.back().size)) {
+			std::cerr << "parseCookedTexture(): level " << i << " is corrupt" << std::endl;
+			return false;
+		}
+		texture.levels.push_back({ static_cast<size_t>(level.offset), static_cast<size_t>(level.size), level.width, level.height });
+	}
+	return true;
+}
+
+bool writeCookedTexture(const char* filename, VkFormat format, uint32_t width, uint32_t height,
+	const std::vector<std::vector<unsigned char>>& levels)
+{
+	if (!isSupportedFormat(format) || levels.empty()) {
+		return false;
+	}
+	CookedTextureHeader header {
+		.magic = COOKED_TEXTURE_MAGIC,
+		.version = COOKED_TEXTURE_VERSION,
+		.format = static_cast<uint32_t>(format),
+		.width = width,
+		.height = height,
+		.levelCount = static_cast<uint32_t>(levels.size()),
+		.reserved = { 0, 0 }
+	};
+	std::vector<CookedTextureLevel> table(levels.size());
+	uint64_t offset = alignOffset(sizeof(header) + table.size() * sizeof(CookedTextureLevel));
+	for (uint32_t i = 0; i < levels.size(); ++i) {
+		table[i] = {
+			.offset = offset,
+			.size = levels[i].size(),
+			.width = std::max(width >> i, 1u),
+			.height = std::max(height >> i, 1u)
+		};
+		if (table[i].size != levelSize(format, table[i].width, table[i].height)) {
+			std::cerr << "writeCookedTexture(): level " << i << " has the wrong size" << std::endl;
+			return false;
+		}
+		offset = alignOffset(offset + table[i].size);
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "writeCookedTexture(): cannot write " << filename << std::endl;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(CookedTextureLevel));
+	static const char padding[COOKED_TEXTURE_ALIGNMENT] = {};
+	for (uint32_t i = 0; i < levels.size(); ++i) {
+		file.write(padding, static_cast<std::streamsize>(table[i].offset - static_cast<uint64_t>(file.tellp())));
+		file.write(reinterpret_cast<const char*>(levels[i].data()), levels[i].size());
+	}
+	return file.good();
+}
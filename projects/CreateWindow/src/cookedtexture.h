@@ -0,0 +1,50 @@
+#pragma once
+
+#include "compressedimage.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+// Cooked textures (.ctex) are written offline by projects/TextureCooker and uploaded without decoding.
+// Layout: CookedTextureHeader, levelCount CookedTextureLevel entries, then every level,
+// largest first, each at a COOKED_TEXTURE_ALIGNMENT aligned file offset.
+// Texels are either BGRA8 in the order FreeImage delivers them or BC blocks.
+
+const uint32_t COOKED_TEXTURE_MAGIC = 0x58455443; // "CTEX"
+const uint32_t COOKED_TEXTURE_VERSION = 1;
+const uint32_t COOKED_TEXTURE_ALIGNMENT = 64;
+
+struct CookedTextureHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format; // VkFormat
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint32_t reserved[2];
+};
+
+struct CookedTextureLevel {
+	uint64_t offset;
+	uint64_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+// level offsets are relative to the start of the file
+struct CookedTexture {
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<CompressedImage::Level> levels;
+};
+
+// true for .ctex file names
+bool isCookedTextureFile(const char* filename);
+
+// checks the header and that every level lies inside the file
+bool parseCookedTexture(const unsigned char* data, size_t size, CookedTexture& texture);
+
+// levels[i] holds the texels of mip level i, tightly packed
+bool writeCookedTexture(const char* filename, VkFormat format, uint32_t width, uint32_t height,
+	const std::vector<std::vector<unsigned char>>& levels);
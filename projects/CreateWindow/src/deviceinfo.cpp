@@ -0,0 +1,112 @@
+#include "deviceinfo.h"
+#include "log.h"
+#include <algorithm>
+#include <bit>
+
+static const MemoryUsage memoryClassUsages[] = {
+	// DeviceLocal
+	{ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT },
+	// InPlace
+	{ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT },
+	// Staging
+	{ VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT },
+	// Dynamic
+	{ VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT },
+	// Readback
+	{ VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT }
+};
+static_assert(std::size(memoryClassUsages) == static_cast<size_t>(MemoryClass::Count));
+
+MemoryUsage::MemoryUsage(MemoryClass memoryClass_)
+	: MemoryUsage(memoryClassUsages[static_cast<uint32_t>(memoryClass_)]) {
+	memoryClass = memoryClass_;
+}
+
+static int scoreMemoryType(VkMemoryPropertyFlags flags, const MemoryUsage& usage) {
+	return std::popcount(flags & usage.preferred) - std::popcount(flags & usage.avoided);
+}
+
+void DeviceInfo::initialize(VkPhysicalDevice physDevice_) {
+	FUNCNAME()
+	physDevice = physDevice_;
+	vkGetPhysicalDeviceProperties(physDevice, &properties);
+	vkGetPhysicalDeviceFeatures(physDevice, &features);
+	vkGetPhysicalDeviceMemoryProperties(physDevice, &memoryProperties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &queueFamilyCount, nullptr);
+	queueFamilies.resize(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &queueFamilyCount, queueFamilies.data());
+
+	formatProperties.resize(CORE_FORMAT_COUNT);
+	for (uint32_t format = 0; format < CORE_FORMAT_COUNT; ++format) {
+		vkGetPhysicalDeviceFormatProperties(physDevice, static_cast<VkFormat>(format), &formatProperties[format]);
+	}
+
+	for (uint32_t memoryClass = 0; memoryClass < static_cast<uint32_t>(MemoryClass::Count); ++memoryClass) {
+		const MemoryUsage& usage = memoryClassUsages[memoryClass];
+		uint32_t* ranked = rankedTypes[memoryClass];
+		uint32_t& count = rankedTypeCounts[memoryClass];
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+			if ((memoryProperties.memoryTypes[i].propertyFlags & usage.required) == usage.required) {
+				ranked[count++] = i;
+			}
+		}
+		std::stable_sort(ranked, ranked + count, [&](uint32_t a, uint32_t b) {
+			return scoreMemoryType(memoryProperties.memoryTypes[a].propertyFlags, usage)
+				> scoreMemoryType(memoryProperties.memoryTypes[b].propertyFlags, usage);
+		});
+	}
+
+	VkDeviceSize largestDeviceHeap = 0;
+	VkDeviceSize largestMappableDeviceHeap = 0;
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+		const VkMemoryType& type = memoryProperties.memoryTypes[i];
+		if ((type.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) == 0) {
+			continue;
+		}
+		VkDeviceSize heapSize = memoryProperties.memoryHeaps[type.heapIndex].size;
+		largestDeviceHeap = std::max(largestDeviceHeap, heapSize);
+		if (type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			largestMappableDeviceHeap = std::max(largestMappableDeviceHeap, heapSize);
+		}
+	}
+	unifiedMemory = largestDeviceHeap > 0 && largestMappableDeviceHeap == largestDeviceHeap;
+}
+
+VkFormatProperties DeviceInfo::getFormatProperties(VkFormat format) const {
+	if (static_cast<uint32_t>(format) < CORE_FORMAT_COUNT) {
+		return formatProperties[format];
+	}
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(physDevice, format, &props);
+	return props;
+}
+
+uint32_t DeviceInfo::findMemoryType(uint32_t typeFilter, const MemoryUsage& usage) const {
+	if (usage.memoryClass != MemoryClass::Count) {
+		uint32_t memoryClass = static_cast<uint32_t>(usage.memoryClass);
+		for (uint32_t i = 0; i < rankedTypeCounts[memoryClass]; ++i) {
+			uint32_t memoryType = rankedTypes[memoryClass][i];
+			if (typeFilter & (1 << memoryType)) {
+				return memoryType;
+			}
+		}
+		return UINT32_MAX;
+	}
+
+	uint32_t bestType = UINT32_MAX;
+	int bestScore = 0;
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+		VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+		if ((typeFilter & (1 << i)) == 0 || (flags & usage.required) != usage.required) {
+			continue;
+		}
+		int score = scoreMemoryType(flags, usage);
+		if (bestType == UINT32_MAX || score > bestScore) {
+			bestType = i;
+			bestScore = score;
+		}
+	}
+	return bestType;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+// The ways resources use memory. Each maps to a MemoryUsage whose ranking DeviceInfo computes once.
+enum class MemoryClass : uint32_t {
+	// only the GPU touches it: images, staged buffers. Avoids HOST_VISIBLE to keep the BAR window free
+	DeviceLocal,
+	// the GPU reads it, the CPU wrote it once in place: static buffers on unified memory
+	InPlace,
+	// written once by the CPU, copied by the GPU
+	Staging,
+	// rewritten by the CPU every frame and read by the GPU: uniforms, streamed vertices
+	Dynamic,
+	// written by the GPU, read by the CPU
+	Readback,
+	Count
+};
+
+// What a resource wants from its memory type. Every type that has all of required is a candidate;
+// the one with the most preferred and fewest avoided flags wins, ties going to the lower index
+// since drivers list faster types first. Converts from plain flags, which are all required,
+// and from a MemoryClass, whose ranking is precomputed.
+struct MemoryUsage {
+	MemoryUsage(VkMemoryPropertyFlags required_ = 0, VkMemoryPropertyFlags preferred_ = 0, VkMemoryPropertyFlags avoided_ = 0)
+		: required(required_), preferred(preferred_), avoided(avoided_) {}
+	MemoryUsage(MemoryClass memoryClass_);
+	VkMemoryPropertyFlags required;
+	VkMemoryPropertyFlags preferred;
+	VkMemoryPropertyFlags avoided;
+	MemoryClass memoryClass = MemoryClass::Count;
+};
+
+// Everything the renderer asks about the physical device, queried once when it has been picked
+// and shared by reference, so creating a buffer or checking a format never goes back to the driver.
+class DeviceInfo {
+public:
+	void initialize(VkPhysicalDevice physDevice);
+
+	inline VkPhysicalDevice getPhysicalDevice() const { return physDevice; }
+	inline const VkPhysicalDeviceProperties& getProperties() const { return properties; }
+	inline const VkPhysicalDeviceLimits& getLimits() const { return properties.limits; }
+	inline const VkPhysicalDeviceFeatures& getFeatures() const { return features; }
+	inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return memoryProperties; }
+	inline const std::vector<VkQueueFamilyProperties>& getQueueFamilies() const { return queueFamilies; }
+
+	// core formats come from the cache; extension formats are queried, so this is safe on any thread
+	VkFormatProperties getFormatProperties(VkFormat format) const;
+
+	// best memory type among typeFilter for usage, UINT32_MAX if none has usage.required.
+	// A MemoryClass walks its precomputed ranking, which usually stops at the first entry
+	uint32_t findMemoryType(uint32_t typeFilter, const MemoryUsage& usage) const;
+	// the largest DEVICE_LOCAL heap is also HOST_VISIBLE (integrated GPUs, resizable BAR): resources
+	// the GPU reads can be written in place instead of through a staging buffer. False when only a
+	// small BAR window is mappable, which is better left to per-frame data
+	inline bool isUnifiedMemory() const { return unifiedMemory; }
+
+private:
+	// VK_FORMAT_UNDEFINED up to the last format of Vulkan 1.0
+	static constexpr uint32_t CORE_FORMAT_COUNT = VK_FORMAT_ASTC_12x12_SRGB_BLOCK + 1;
+
+	VkPhysicalDevice physDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties properties;
+	VkPhysicalDeviceFeatures features;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	std::vector<VkQueueFamilyProperties> queueFamilies;
+	std::vector<VkFormatProperties> formatProperties;
+	// per MemoryClass, the candidate memory types best first
+	uint32_t rankedTypes[static_cast<uint32_t>(MemoryClass::Count)][VK_MAX_MEMORY_TYPES];
+	uint32_t rankedTypeCounts[static_cast<uint32_t>(MemoryClass::Count)] = {};
+	bool unifiedMemory = false;
+};
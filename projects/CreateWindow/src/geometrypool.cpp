@@ -0,0 +1,139 @@
+#include "geometrypool.h"
+#include "utils.h"
+#include "log.h"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+	VkDeviceSize indexSize(VkIndexType indexType) {
+		return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+}
+
+void GeometryPool::initialize(VkDevice device_, DeviceAllocator& allocator_, VkDeviceSize pageSize_) {
+	FUNCNAME()
+	device = device_;
+	allocator = &allocator_;
+	pageSize = pageSize_;
+}
+
+void GeometryPool::destroy() {
+	for (Page& page : pages) {
+		destroyBuffer(device, *allocator, page.buffer, page.allocation);
+	}
+	pages.clear();
+}
+
+uint32_t GeometryPool::createPage(VkDeviceSize size) {
+	TRACE_ZONE(TRACE_CATEGORY_RESOURCE, "geometry page")
+	Page page;
+	// on unified memory the pool is written in place, like UploadBatch::createStaticBuffer does
+	VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+		| VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	if (!allocator->isUnifiedMemory() || !tryCreateBuffer(device, *allocator, size, usage,
+		MemoryClass::InPlace,
+		page.buffer, page.allocation)) {
+		createBuffer(device, *allocator, size, usage,
+			MemoryClass::DeviceLocal,
+			page.buffer, page.allocation);
+	}
+	page.ranges.initialize(size);
+	pages.push_back(page);
+	return static_cast<uint32_t>(pages.size() - 1);
+}
+
+bool GeometryPool::allocateIn(Page& page, GeometryRange& range) {
+	VkDeviceSize vertexOffset;
+	if (!page.ranges.allocate(static_cast<VkDeviceSize>(range.vertexCount) * range.vertexStride,
+		range.vertexStride, vertexOffset)) {
+		return false;
+	}
+	VkDeviceSize indexOffset;
+	VkDeviceSize indexStride = indexSize(range.indexType);
+	if (!page.ranges.allocate(range.indexCount * indexStride, indexStride, indexOffset)) {
+		page.ranges.free(vertexOffset, static_cast<VkDeviceSize>(range.vertexCount) * range.vertexStride);
+		return false;
+	}
+	range.firstVertex = static_cast<uint32_t>(vertexOffset / range.vertexStride);
+	range.firstIndex = static_cast<uint32_t>(indexOffset / indexStride);
+	return true;
+}
+
+GeometryRange GeometryPool::allocate(uint32_t vertexCount, uint32_t vertexStride, uint32_t indexCount,
+	VkIndexType indexType) {
+	assert(vertexCount > 0 && indexCount > 0);
+	assert((vertexStride & (vertexStride - 1)) == 0);
+	GeometryRange range {
+		.page = UINT32_MAX,
+		.firstVertex = 0,
+		.vertexCount = vertexCount,
+		.vertexStride = vertexStride,
+		.firstIndex = 0,
+		.indexCount = indexCount,
+		.indexType = indexType
+	};
+	for (uint32_t i = 0; i < pages.size(); ++i) {
+		if (allocateIn(pages[i], range)) {
+			range.page = i;
+			return range;
+		}
+	}
+	// a mesh larger than a page gets a page of its own size, with room for both alignments
+	VkDeviceSize size = static_cast<VkDeviceSize>(vertexCount) * vertexStride + indexCount * indexSize(indexType)
+		+ vertexStride + indexSize(indexType);
+	range.page = createPage(std::max(pageSize, size));
+	if (!allocateIn(pages[range.page], range)) {
+		assert(0);
+	}
+	return range;
+}
+
+void GeometryPool::free(GeometryRange& range) {
+	if (range.page == UINT32_MAX) {
+		return;
+	}
+	Page& page = pages[range.page];
+	page.ranges.free(static_cast<VkDeviceSize>(range.firstVertex) * range.vertexStride,
+		static_cast<VkDeviceSize>(range.vertexCount) * range.vertexStride);
+	VkDeviceSize indexStride = indexSize(range.indexType);
+	page.ranges.free(range.firstIndex * indexStride, range.indexCount * indexStride);
+	// empty pages are kept: the next mesh streamed in would only create one again
+	range = GeometryRange();
+}
+
+void GeometryPool::upload(UploadBatch& upload, const GeometryRange& range, const void* vertices, const void* indices) {
+	const Page& page = pages[range.page];
+	VkDeviceSize vertexOffset = static_cast<VkDeviceSize>(range.firstVertex) * range.vertexStride;
+	VkDeviceSize vertexBytes = static_cast<VkDeviceSize>(range.vertexCount) * range.vertexStride;
+	VkDeviceSize indexStride = indexSize(range.indexType);
+	VkDeviceSize indexOffset = range.firstIndex * indexStride;
+	VkDeviceSize indexBytes = range.indexCount * indexStride;
+	if (page.allocation.mapped != nullptr) {
+		// host writes before the vkQueueSubmit that uses the range are visible to it without a barrier
+		char* mapped = static_cast<char*>(page.allocation.mapped);
+		memcpy(mapped + vertexOffset, vertices, static_cast<size_t>(vertexBytes));
+		memcpy(mapped + indexOffset, indices, static_cast<size_t>(indexBytes));
+		allocator->flush(page.allocation, vertexOffset, vertexBytes);
+		allocator->flush(page.allocation, indexOffset, indexBytes);
+		return;
+	}
+	UploadBatch::Staging stagedVertices = upload.stage(vertices, vertexBytes);
+	upload.copyBuffer(stagedVertices.buffer, stagedVertices.offset, page.buffer, vertexBytes, vertexOffset);
+	UploadBatch::Staging stagedIndices = upload.stage(indices, indexBytes);
+	upload.copyBuffer(stagedIndices.buffer, stagedIndices.offset, page.buffer, indexBytes, indexOffset);
+}
+
+void GeometryPool::bind(VkCommandBuffer commandBuffer, const GeometryRange& range, GeometryBinding& binding) const {
+	if (binding.page != range.page) {
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &pages[range.page].buffer, &offset);
+	}
+	if (binding.page != range.page || binding.indexType != range.indexType) {
+		vkCmdBindIndexBuffer(commandBuffer, pages[range.page].buffer, 0, range.indexType);
+	}
+	binding.page = range.page;
+	binding.indexType = range.indexType;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+#include "allocator.h"
+#include "upload.h"
+
+// Where a mesh's vertices and indices live in a GeometryPool, in the units vkCmdDrawIndexed takes:
+// add firstIndex and firstVertex to the draw's firstIndex and vertexOffset.
+struct GeometryRange {
+	uint32_t page = UINT32_MAX;
+	uint32_t firstVertex = 0;
+	uint32_t vertexCount = 0;
+	uint32_t vertexStride = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+};
+
+// what the command buffer being recorded has bound, so draws from the same page skip rebinding.
+// Start each command buffer with a fresh one
+struct GeometryBinding {
+	uint32_t page = UINT32_MAX;
+	VkIndexType indexType = VK_INDEX_TYPE_MAX_ENUM;
+};
+
+// Vertices and indices of every mesh, sub-allocated from a few large buffers ("pages") that are
+// each bound once as both the vertex and the index buffer. Meshes on the same page differ only in
+// firstIndex and vertexOffset, which is also what indirect draws need. Ranges are first fit from a
+// free list per page, so meshes can be streamed in and out; a page is added when none has room.
+//
+//	GeometryRange range = pool.allocate(vertexCount, sizeof(Vertex), indexCount, VK_INDEX_TYPE_UINT32);
+//	pool.upload(upload, range, vertices, indices);
+//	pool.bind(commandBuffer, range, binding);
+//	vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, range.firstIndex, range.firstVertex, 0);
+class GeometryPool {
+public:
+	static constexpr VkDeviceSize DEFAULT_PAGE_SIZE = 32ull * 1024 * 1024;
+
+	void initialize(VkDevice device, DeviceAllocator& allocator, VkDeviceSize pageSize = DEFAULT_PAGE_SIZE);
+	void destroy();
+
+	// vertexStride has to be a power of two, so the vertices start at a whole vertexOffset
+	GeometryRange allocate(uint32_t vertexCount, uint32_t vertexStride, uint32_t indexCount, VkIndexType indexType);
+	// the GPU must be done with the range, e.g. the fences of every frame that drew it have signaled
+	void free(GeometryRange& range);
+	// fills a range: in place on unified memory, otherwise through upload's staging memory
+	void upload(UploadBatch& upload, const GeometryRange& range, const void* vertices, const void* indices);
+
+	void bind(VkCommandBuffer commandBuffer, const GeometryRange& range, GeometryBinding& binding) const;
+
+	inline size_t getPageCount() const { return pages.size(); }
+
+private:
+	struct Page {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		Allocation allocation;
+		RangeAllocator ranges;
+	};
+
+	uint32_t createPage(VkDeviceSize size);
+	bool allocateIn(Page& page, GeometryRange& range);
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceAllocator* allocator = nullptr;
+	VkDeviceSize pageSize = DEFAULT_PAGE_SIZE;
+	std::vector<Page> pages;
+};
@@ -0,0 +1,165 @@
+#include "gpuprofiler.h"
+#include "log.h"
+#include <cassert>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+void GpuProfiler::initialize(const DeviceInfo& deviceInfo, VkDevice device_, uint32_t queueFamilyIndex,
+	uint32_t frameCount, uint32_t maxScopesPerFrame)
+{
+	FUNCNAME()
+	device = device_;
+	maxScopes = maxScopesPerFrame;
+	frames.resize(frameCount);
+
+	timestampPeriod = deviceInfo.getLimits().timestampPeriod;
+	uint32_t validBits = deviceInfo.getQueueFamilies()[queueFamilyIndex].timestampValidBits;
+	supported = validBits > 0;
+	if (!supported) {
+		std::cerr << "GpuProfiler: the graphics queue does not support timestamps" << std::endl;
+		return;
+	}
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkQueryPoolCreateInfo createInfo {
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = frameCount * maxScopes * 2
+	};
+	if (vkCreateQueryPool(device, &createInfo, nullptr, &queryPool) != VK_SUCCESS) {
+		assert(0);
+	}
+}
+
+void GpuProfiler::destroy() {
+	if (queryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryPool = VK_NULL_HANDLE;
+	}
+	csv.close();
+}
+
+void GpuProfiler::setCsvPath(const std::string& path) {
+	csv.open(path, std::ios::trunc);
+	if (!csv.is_open()) {
+		std::cerr << "GpuProfiler: cannot write " << path << std::endl;
+		return;
+	}
+	csv << "frame,scope,ms" << std::endl;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frame) {
+	if (!supported) {
+		return;
+	}
+	resolve(frame);
+	currentFrame = frame;
+	FrameQueries& queries = frames[frame];
+	queries.scopes.clear();
+	queries.frameNumber = frameNumber++;
+	queries.pending = true;
+	vkCmdResetQueryPool(commandBuffer, queryPool, frame * maxScopes * 2, maxScopes * 2);
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name) {
+	if (!supported) {
+		return 0;
+	}
+	FrameQueries& queries = frames[currentFrame];
+	assert(queries.scopes.size() < maxScopes);
+	uint32_t scope = static_cast<uint32_t>(queries.scopes.size());
+	queries.scopes.push_back(findScope(name));
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool,
+		(currentFrame * maxScopes + scope) * 2);
+	return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+	if (!supported) {
+		return;
+	}
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool,
+		(currentFrame * maxScopes + scope) * 2 + 1);
+}
+
+uint32_t GpuProfiler::findScope(const char* name) {
+	for (uint32_t i = 0; i < stats.size(); ++i) {
+		if (stats[i].name == name) {
+			return i;
+		}
+	}
+	ScopeStats scope;
+	scope.name = name;
+	scope.samples.reserve(WINDOW_SIZE);
+	stats.push_back(std::move(scope));
+	return static_cast<uint32_t>(stats.size() - 1);
+}
+
+void GpuProfiler::resolve(uint32_t frame) {
+	FrameQueries& queries = frames[frame];
+	if (!queries.pending || queries.scopes.empty()) {
+		queries.pending = false;
+		return;
+	}
+	uint32_t queryCount = static_cast<uint32_t>(queries.scopes.size()) * 2;
+	std::vector<uint64_t> timestamps(queryCount);
+	// the frame's fence has signaled, so the results are available without VK_QUERY_RESULT_WAIT_BIT
+	VkResult result = vkGetQueryPoolResults(device, queryPool, frame * maxScopes * 2, queryCount,
+		timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	queries.pending = false;
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	for (size_t i = 0; i < queries.scopes.size(); ++i) {
+		uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & timestampMask;
+		float ms = static_cast<float>(ticks) * timestampPeriod / 1000000.0f;
+		ScopeStats& scope = stats[queries.scopes[i]];
+		if (scope.samples.size() < WINDOW_SIZE) {
+			scope.samples.push_back(ms);
+		} else {
+			scope.samples[scope.next] = ms;
+		}
+		scope.next = (scope.next + 1) % WINDOW_SIZE;
+		if (csv.is_open()) {
+			csv << queries.frameNumber << "," << scope.name << "," << ms << "\n";
+		}
+	}
+}
+
+void GpuProfiler::flush() {
+	if (!supported) {
+		return;
+	}
+	for (uint32_t i = 0; i < frames.size(); ++i) {
+		resolve(i);
+	}
+	if (csv.is_open()) {
+		csv.flush();
+	}
+}
+
+void GpuProfiler::printStats() const {
+	if (!supported) {
+		return;
+	}
+	std::cout << "GPU time (last " << WINDOW_SIZE << " frames)      min      avg      p99" << std::endl;
+	for (const ScopeStats& scope : stats) {
+		if (scope.samples.empty()) {
+			continue;
+		}
+		std::vector<float> sorted = scope.samples;
+		std::sort(sorted.begin(), sorted.end());
+		float sum = 0.0f;
+		for (float sample : sorted) {
+			sum += sample;
+		}
+		size_t p99 = (sorted.size() - 1) * 99 / 100;
+		std::cout << "\t" << std::left << std::setw(24) << scope.name << std::right << std::fixed << std::setprecision(3)
+			<< std::setw(9) << sorted.front()
+			<< std::setw(9) << sum / static_cast<float>(sorted.size())
+			<< std::setw(9) << sorted[p99] << " ms" << std::endl;
+		std::cout.unsetf(std::ios::floatfield);
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "deviceinfo.h"
+#include <vector>
+#include <string>
+#include <fstream>
+
+// GPU timings from timestamp queries, one query range per frame in flight.
+// Results of a frame are read back the next time its slot comes around, after the
+// frame's fence has been waited on, so reading them never stalls.
+//
+//	profiler.beginFrame(commandBuffer, frame);	// outside any render pass
+//	uint32_t scope = profiler.beginScope(commandBuffer, "main pass");
+//	...
+//	profiler.endScope(commandBuffer, scope);
+class GpuProfiler {
+public:
+	void initialize(const DeviceInfo& deviceInfo, VkDevice device, uint32_t queueFamilyIndex,
+		uint32_t frameCount, uint32_t maxScopesPerFrame);
+	void destroy();
+
+	// when set, every resolved scope is appended as "frame,scope,ms"
+	void setCsvPath(const std::string& path);
+
+	// collects the results of this slot's previous frame and resets its queries
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frame);
+	uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+	void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+	// collects every outstanding frame; the device must be idle
+	void flush();
+
+	// rolling min/avg/p99 over the last WINDOW_SIZE frames of every scope
+	void printStats() const;
+	inline bool isSupported() const { return supported; }
+
+	static constexpr size_t WINDOW_SIZE = 256;
+
+private:
+	struct ScopeStats {
+		std::string name;
+		std::vector<float> samples;
+		size_t next = 0;
+	};
+	struct FrameQueries {
+		// stats index of every scope written this frame, in query order
+		std::vector<uint32_t> scopes;
+		uint64_t frameNumber = 0;
+		bool pending = false;
+	};
+
+	void resolve(uint32_t frame);
+	uint32_t findScope(const char* name);
+
+	VkDevice device;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	bool supported = false;
+	// nanoseconds per tick
+	float timestampPeriod = 1.0f;
+	uint64_t timestampMask = ~0ull;
+	uint32_t maxScopes = 0;
+	uint32_t currentFrame = 0;
+	uint64_t frameNumber = 0;
+	std::vector<FrameQueries> frames;
+	std::vector<ScopeStats> stats;
+	std::ofstream csv;
+};
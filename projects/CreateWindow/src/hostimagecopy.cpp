@@ -0,0 +1,198 @@
+#include "hostimagecopy.h"
+#include "log.h"
+#include <cstring>
+#include <algorithm>
+
+#ifdef VK_EXT_host_image_copy
+
+bool HostImageCopy::isSupported(VkInstance instance, VkPhysicalDevice physDevice) {
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physDevice, nullptr, &extensionCount, availableExtensions.data());
+	for (const char* name : getDeviceExtensions()) {
+		bool found = std::any_of(availableExtensions.begin(), availableExtensions.end(),
+			[name](const VkExtensionProperties& extension) { return strcmp(extension.extensionName, name) == 0; });
+		if (!found) {
+			return false;
+		}
+	}
+
+	auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+		vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+	if (getFeatures2 == nullptr) {
+		return false;
+	}
+	VkPhysicalDeviceHostImageCopyFeaturesEXT hostImageCopyFeatures {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT
+	};
+	VkPhysicalDeviceFeatures2 features {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &hostImageCopyFeatures
+	};
+	getFeatures2(physDevice, &features);
+	return hostImageCopyFeatures.hostImageCopy == VK_TRUE;
+}
+
+const std::vector<const char*>& HostImageCopy::getDeviceExtensions() {
+	static const std::vector<const char*> extensions = {
+		VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME,
+		VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME,
+		VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME
+	};
+	return extensions;
+}
+
+VkImageUsageFlags HostImageCopy::getUsage() {
+	// TRANSFER_SRC lets the texture streamer copy levels out of the image when it drops them
+	return VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+}
+
+void HostImageCopy::initialize(VkInstance instance, VkPhysicalDevice physDevice_, VkDevice device_) {
+	FUNCNAME()
+	physDevice = physDevice_;
+	auto getProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(
+		vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR"));
+	getFormatProperties2 = vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFormatProperties2KHR");
+	getImageFormatProperties2 = vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceImageFormatProperties2KHR");
+	copyMemoryToImage = vkGetDeviceProcAddr(device_, "vkCopyMemoryToImageEXT");
+	transitionImageLayout = vkGetDeviceProcAddr(device_, "vkTransitionImageLayoutEXT");
+	if (getProperties2 == nullptr || getFormatProperties2 == nullptr || getImageFormatProperties2 == nullptr
+		|| copyMemoryToImage == nullptr || transitionImageLayout == nullptr) {
+		return;
+	}
+
+	// the layouts a copy may target; first query the count, then the list
+	VkPhysicalDeviceHostImageCopyPropertiesEXT hostImageCopyProperties {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT
+	};
+	VkPhysicalDeviceProperties2 properties {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+		.pNext = &hostImageCopyProperties
+	};
+	getProperties2(physDevice, &properties);
+	std::vector<VkImageLayout> dstLayouts(hostImageCopyProperties.copyDstLayoutCount);
+	hostImageCopyProperties.pCopyDstLayouts = dstLayouts.data();
+	getProperties2(physDevice, &properties);
+	copyToShaderReadOnly = std::find(dstLayouts.begin(), dstLayouts.end(),
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) != dstLayouts.end();
+	// without it the image would need a GPU transition after all, which is what the staging path does
+	if (copyToShaderReadOnly) {
+		device = device_;
+	}
+}
+
+bool HostImageCopy::supportsFormat(VkFormat format) const {
+	if (!isEnabled()) {
+		return false;
+	}
+	VkFormatProperties3 formatProperties3 {
+		.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3
+	};
+	VkFormatProperties2 formatProperties {
+		.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2,
+		.pNext = &formatProperties3
+	};
+	reinterpret_cast<PFN_vkGetPhysicalDeviceFormatProperties2KHR>(getFormatProperties2)(physDevice, format, &formatProperties);
+	if ((formatProperties3.optimalTilingFeatures & VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT_EXT) == 0) {
+		return false;
+	}
+
+	// some drivers store host-copyable images in a layout the GPU samples more slowly
+	VkHostImageCopyDevicePerformanceQueryEXT performance {
+		.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_COPY_DEVICE_PERFORMANCE_QUERY_EXT
+	};
+	VkImageFormatProperties2 imageFormatProperties {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2,
+		.pNext = &performance
+	};
+	VkPhysicalDeviceImageFormatInfo2 imageFormatInfo {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2,
+		.format = format,
+		.type = VK_IMAGE_TYPE_2D,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = getUsage()
+	};
+	if (reinterpret_cast<PFN_vkGetPhysicalDeviceImageFormatProperties2KHR>(getImageFormatProperties2)(
+		physDevice, &imageFormatInfo, &imageFormatProperties) != VK_SUCCESS) {
+		return false;
+	}
+	return performance.optimalDeviceAccess == VK_TRUE;
+}
+
+bool HostImageCopy::upload(VkImage image, uint32_t levelCount, const void* const* levels, const VkExtent2D* extents) const {
+	TRACE_ZONE(TRACE_CATEGORY_RESOURCE, "host image copy")
+	VkHostImageLayoutTransitionInfoEXT transition {
+		.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT,
+		.image = image,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = levelCount,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+	if (reinterpret_cast<PFN_vkTransitionImageLayoutEXT>(transitionImageLayout)(device, 1, &transition) != VK_SUCCESS) {
+		return false;
+	}
+
+	std::vector<VkMemoryToImageCopyEXT> regions(levelCount);
+	for (uint32_t i = 0; i < levelCount; ++i) {
+		regions[i] = {
+			.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT,
+			.pNext = nullptr,
+			.pHostPointer = levels[i],
+			.memoryRowLength = 0,
+			.memoryImageHeight = 0,
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = i,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.imageOffset = { 0, 0, 0 },
+			.imageExtent = { extents[i].width, extents[i].height, 1 }
+		};
+	}
+	VkCopyMemoryToImageInfoEXT copyInfo {
+		.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT,
+		.pNext = nullptr,
+		.flags = 0,
+		.dstImage = image,
+		.dstImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.regionCount = levelCount,
+		.pRegions = regions.data()
+	};
+	return reinterpret_cast<PFN_vkCopyMemoryToImageEXT>(copyMemoryToImage)(device, &copyInfo) == VK_SUCCESS;
+}
+
+#else
+
+bool HostImageCopy::isSupported(VkInstance, VkPhysicalDevice) {
+	return false;
+}
+
+const std::vector<const char*>& HostImageCopy::getDeviceExtensions() {
+	static const std::vector<const char*> extensions;
+	return extensions;
+}
+
+VkImageUsageFlags HostImageCopy::getUsage() {
+	return 0;
+}
+
+void HostImageCopy::initialize(VkInstance, VkPhysicalDevice, VkDevice) {
+}
+
+bool HostImageCopy::supportsFormat(VkFormat) const {
+	return false;
+}
+
+bool HostImageCopy::upload(VkImage, uint32_t, const void* const*, const VkExtent2D*) const {
+	return false;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+// VK_EXT_host_image_copy: the CPU writes texels straight into an optimal-tiled image, so an upload
+// needs neither a staging buffer nor a queue submission. Compiles to an always-unsupported stub
+// with headers older than the extension.
+//
+//	if (HostImageCopy::isSupported(instance, physDevice)) // enable getDeviceExtensions() and the feature
+//	hostImageCopy.initialize(instance, physDevice, device);
+//	if (hostImageCopy.supportsFormat(format)) { /* create with getUsage(), then upload() */ }
+class HostImageCopy {
+public:
+	// the extensions and the hostImageCopy feature; the instance needs VK_KHR_get_physical_device_properties2
+	static bool isSupported(VkInstance instance, VkPhysicalDevice physDevice);
+	// VK_EXT_host_image_copy and what it depends on
+	static const std::vector<const char*>& getDeviceExtensions();
+	// usage of a sampled texture filled by host copies; supportsFormat() checks exactly this usage
+	static VkImageUsageFlags getUsage();
+
+	// device must have been created with getDeviceExtensions() and the hostImageCopy feature
+	void initialize(VkInstance instance, VkPhysicalDevice physDevice, VkDevice device);
+	inline bool isEnabled() const { return device != VK_NULL_HANDLE; }
+
+	// whether sampled images of format can take host copies without slowing down GPU access to them
+	bool supportsFormat(VkFormat format) const;
+	// writes the levels of a new image, which ends up in SHADER_READ_ONLY_OPTIMAL ready to sample.
+	// rows of every level are tightly packed; returns once the texels are in the image
+	bool upload(VkImage image, uint32_t levelCount, const void* const* levels, const VkExtent2D* extents) const;
+
+private:
+	VkPhysicalDevice physDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	PFN_vkVoidFunction getFormatProperties2 = nullptr;
+	PFN_vkVoidFunction getImageFormatProperties2 = nullptr;
+	PFN_vkVoidFunction copyMemoryToImage = nullptr;
+	PFN_vkVoidFunction transitionImageLayout = nullptr;
+	// copies can go straight into SHADER_READ_ONLY_OPTIMAL
+	bool copyToShaderReadOnly = false;
+};
@@ -0,0 +1,33 @@
+#include "imagefilter.h"
+#include <cstddef>
+#include <algorithm>
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+		++levels;
+	}
+	return levels;
+}
+
+void downsampleBox(const unsigned char* src, uint32_t width, uint32_t height, unsigned char* dst) {
+	uint32_t dstWidth = std::max(width / 2, 1u);
+	uint32_t dstHeight = std::max(height / 2, 1u);
+	for (uint32_t y = 0; y < dstHeight; ++y) {
+		// a dimension of 1 has no second row or column to average with
+		uint32_t y0 = std::min(y * 2, height - 1);
+		uint32_t y1 = std::min(y * 2 + 1, height - 1);
+		for (uint32_t x = 0; x < dstWidth; ++x) {
+			uint32_t x0 = std::min(x * 2, width - 1);
+			uint32_t x1 = std::min(x * 2 + 1, width - 1);
+			const unsigned char* p00 = src + (static_cast<size_t>(y0) * width + x0) * 4;
+			const unsigned char* p01 = src + (static_cast<size_t>(y0) * width + x1) * 4;
+			const unsigned char* p10 = src + (static_cast<size_t>(y1) * width + x0) * 4;
+			const unsigned char* p11 = src + (static_cast<size_t>(y1) * width + x1) * 4;
+			unsigned char* out = dst + (static_cast<size_t>(y) * dstWidth + x) * 4;
+			for (uint32_t c = 0; c < 4; ++c) {
+				out[c] = static_cast<unsigned char>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+			}
+		}
+	}
+}
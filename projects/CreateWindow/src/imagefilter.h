@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Vulkan-free image helpers, shared with the texture cooker.
+
+// floor(log2(max(width, height))) + 1
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+// 2x2 box filter of a tightly packed 4 bytes per texel image.
+// dst must hold max(width / 2, 1) * max(height / 2, 1) texels
+void downsampleBox(const unsigned char* src, uint32_t width, uint32_t height, unsigned char* dst);
@@ -1,47 +1,157 @@
 #include "imageloader.h"
 #include <iostream>
+#include <cstring>
 #include <algorithm>
 using std::max;
 
+#if defined(_M_X64) || defined(__x86_64__)
+#define IMAGELOADER_SSSE3
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SSSE3_TARGET
+#else
+#include <cpuid.h>
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+#endif
+
+#ifdef _MSC_VER
 #pragma comment(lib, "FreeImage.lib")
+#endif
 
 namespace freeimage {
 
+	namespace {
+
+		void expandBGRToBGRA(const unsigned char* src, unsigned char* dst, size_t count) {
+			for (size_t x = 0; x < count; ++x, src += 3, dst += 4) {
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+				dst[3] = 255;
+			}
+		}
+
+#ifdef IMAGELOADER_SSSE3
+		bool hasSSSE3() {
+			static const bool supported = [] {
+#ifdef _MSC_VER
+				int info[4];
+				__cpuid(info, 1);
+				return (info[2] & (1 << 9)) != 0;
+#else
+				unsigned int eax, ebx, ecx, edx;
+				return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSSE3) != 0;
+#endif
+			}();
+			return supported;
+		}
+
+		// 4 texels per shuffle: 12 bytes of BGR spread over 16 bytes, alpha ORed in
+		SSSE3_TARGET void expandBGRToBGRA_SSSE3(const unsigned char* src, unsigned char* dst, size_t count) {
+			const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+			size_t x = 0;
+			// each load reads 16 bytes but consumes 12, so stop while the last load stays inside the row
+			for (; x + 6 <= count; x += 4) {
+				__m128i bgr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3));
+				__m128i bgra = _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), alpha);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), bgra);
+			}
+			expandBGRToBGRA(src + x * 3, dst + x * 4, count - x);
+		}
+#else
+		bool hasSSSE3() {
+			return false;
+		}
+
+		void expandBGRToBGRA_SSSE3(const unsigned char* src, unsigned char* dst, size_t count) {
+			expandBGRToBGRA(src, dst, count);
+		}
+#endif
+
+	}
+
 	ImageData::ImageData(FIBITMAP* dib_) {
 		dib = dib_;
-		buffer = FreeImage_GetBits(dib);
-		width = FreeImage_GetWidth(dib);
-		height = FreeImage_GetHeight(dib);
+		width = dib ? FreeImage_GetWidth(dib) : 0;
+		height = dib ? FreeImage_GetHeight(dib) : 0;
 	}
 
 	void ImageData::unload() {
 		if (dib) {
 			FreeImage_Unload(dib);
 			dib = nullptr;
-			buffer = nullptr;
 		}
 	}
 
-	// CAUTION: forces to 32 bits
+	bool ImageData::copyTo(unsigned char* dst, size_t dstRowPitch) const {
+		if (!dib || dstRowPitch < width * 4) {
+			return false;
+		}
+		unsigned int bpp = FreeImage_GetBPP(dib);
+		if (FreeImage_GetImageType(dib) != FIT_BITMAP || (bpp != 24 && bpp != 32)) {
+			// palettized and grayscale images are rare enough to go through FreeImage's converter
+			FIBITMAP* converted = FreeImage_ConvertTo32Bits(dib);
+			if (!converted) {
+				return false;
+			}
+			ImageData convertedData(converted);
+			bool copied = convertedData.copyTo(dst, dstRowPitch);
+			convertedData.unload();
+			return copied;
+		}
+		bool simd = bpp == 24 && hasSSSE3();
+		for (unsigned int y = 0; y < height; ++y) {
+			const unsigned char* src = FreeImage_GetScanLine(dib, static_cast<int>(y));
+			unsigned char* row = dst + y * dstRowPitch;
+			if (bpp == 32) {
+				memcpy(row, src, width * 4);
+			} else if (simd) {
+				expandBGRToBGRA_SSSE3(src, row, width);
+			} else {
+				expandBGRToBGRA(src, row, width);
+			}
+		}
+		return true;
+	}
+
+	// decodes only; the conversion to 32 bits is left to ImageData::copyTo
 	ImageData loadImage(const char* filename) {
-		FIBITMAP *img = NULL, *dib = NULL;
 		FREE_IMAGE_FORMAT fif = FreeImage_GetFIFFromFilename(filename);
-		img = FreeImage_Load(fif, filename, 0);
+		FIBITMAP* img = FreeImage_Load(fif, filename, 0);
 		if (!img) {
 			std::cerr << "Error loading: " << filename << std::endl;
 		}
-		unsigned int bpp = FreeImage_GetBPP(img);
-		if (bpp == 32) {
-			dib = FreeImage_ConvertTo32Bits(img);
-		} else if (bpp == 24) {
-			dib = FreeImage_ConvertTo32Bits(img);
-		} else {
-			std::cerr << "loadImage(): An image with unexpected BPP " << bpp << std::endl;
-		}
-		FreeImage_Unload(img);
+		return ImageData(img);
+	}
 
-		ImageData ret(dib);
-		return ret;
+	bool saveImage(const char* filename, const unsigned char* bgra, size_t width, size_t height) {
+		FREE_IMAGE_FORMAT fif = FreeImage_GetFIFFromFilename(filename);
+		if (fif == FIF_UNKNOWN) {
+			std::cerr << "saveImage(): unknown image format: " << filename << std::endl;
+			return false;
+		}
+		// FreeImage stores pixels as BGRA on little endian machines, so the bits are used as is
+		FIBITMAP* dib = FreeImage_ConvertFromRawBits(const_cast<BYTE*>(bgra),
+			static_cast<int>(width), static_cast<int>(height), static_cast<int>(width * 4), 32,
+			FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, TRUE);
+		if (!dib) {
+			return false;
+		}
+		// formats without alpha reject 32-bit bitmaps
+		if (fif == FIF_JPEG) {
+			FIBITMAP* rgb = FreeImage_ConvertTo24Bits(dib);
+			FreeImage_Unload(dib);
+			dib = rgb;
+		}
+		bool saved = FreeImage_Save(fif, dib, filename, 0) == TRUE;
+		if (!saved) {
+			std::cerr << "Error saving: " << filename << std::endl;
+		}
+		FreeImage_Unload(dib);
+		return saved;
 	}
 
 	/*
@@ -4,17 +4,24 @@
 
 namespace freeimage {
 
+	// A decoded bitmap in whatever layout the codec produced (24-bit for JPEG).
+	// copyTo() converts it to 32-bit BGRA straight into the caller's memory, e.g. mapped
+	// staging, so no intermediate 32-bit copy is made.
 	struct ImageData {
 		ImageData(FIBITMAP*);
 		void unload();
+		inline bool isValid() const { return dib != nullptr; }
+		// rows are dstRowPitch bytes apart (at least width * 4), bottom row first like FreeImage
+		bool copyTo(unsigned char* dst, size_t dstRowPitch) const;
 		size_t width;
 		size_t height;
-		unsigned char* buffer;
 	private:
 		FIBITMAP* dib;
 	};
 
 	ImageData loadImage(const char* filename);
+	// writes tightly packed 32-bit BGRA rows, top row first; the format follows the extension
+	bool saveImage(const char* filename, const unsigned char* bgra, size_t width, size_t height);
 	//void loadTexture(ImageData&);
 
 }
\ No newline at end of file
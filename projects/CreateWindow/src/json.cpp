@@ -0,0 +1,285 @@
+#include "json.h"
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+	// nesting deeper than this is certainly not glTF, and would only risk the stack
+	const int MAX_DEPTH = 64;
+
+	class JsonParser {
+	public:
+		JsonParser(const char* text, size_t length) : cursor(text), begin(text), end(text + length) {}
+
+		bool parseDocument(JsonValue& value, std::string& error) {
+			bool ok = parseValue(value, 0);
+			skipWhitespace();
+			if (ok && cursor != end) {
+				ok = fail("trailing characters");
+			}
+			if (!ok) {
+				error = message + " at offset " + std::to_string(cursor - begin);
+			}
+			return ok;
+		}
+
+	private:
+		bool fail(const char* what) {
+			if (message.empty()) {
+				message = what;
+			}
+			return false;
+		}
+
+		void skipWhitespace() {
+			while (cursor != end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) {
+				++cursor;
+			}
+		}
+
+		bool consume(const char* literal) {
+			size_t length = strlen(literal);
+			if (static_cast<size_t>(end - cursor) < length || memcmp(cursor, literal, length) != 0) {
+				return fail("invalid literal");
+			}
+			cursor += length;
+			return true;
+		}
+
+		bool parseValue(JsonValue& value, int depth) {
+			if (depth > MAX_DEPTH) {
+				return fail("nested too deeply");
+			}
+			skipWhitespace();
+			if (cursor == end) {
+				return fail("unexpected end");
+			}
+			switch (*cursor) {
+			case '{':
+				return parseObject(value, depth);
+			case '[':
+				return parseArray(value, depth);
+			case '"':
+				value.type = JsonValue::Type::String;
+				return parseString(value.string);
+			case 't':
+				value.type = JsonValue::Type::Bool;
+				value.boolean = true;
+				return consume("true");
+			case 'f':
+				value.type = JsonValue::Type::Bool;
+				value.boolean = false;
+				return consume("false");
+			case 'n':
+				value.type = JsonValue::Type::Null;
+				return consume("null");
+			default:
+				return parseNumber(value);
+			}
+		}
+
+		bool parseObject(JsonValue& value, int depth) {
+			value.type = JsonValue::Type::Object;
+			++cursor;
+			skipWhitespace();
+			if (cursor != end && *cursor == '}') {
+				++cursor;
+				return true;
+			}
+			while (true) {
+				skipWhitespace();
+				JsonMember member;
+				if (cursor == end || *cursor != '"' || !parseString(member.key)) {
+					return fail("expected a key");
+				}
+				skipWhitespace();
+				if (cursor == end || *cursor != ':') {
+					return fail("expected ':'");
+				}
+				++cursor;
+				if (!parseValue(member.value, depth + 1)) {
+					return false;
+				}
+				value.object.push_back(std::move(member));
+				skipWhitespace();
+				if (cursor != end && *cursor == ',') {
+					++cursor;
+				} else if (cursor != end && *cursor == '}') {
+					++cursor;
+					return true;
+				} else {
+					return fail("expected ',' or '}'");
+				}
+			}
+		}
+
+		bool parseArray(JsonValue& value, int depth) {
+			value.type = JsonValue::Type::Array;
+			++cursor;
+			skipWhitespace();
+			if (cursor != end && *cursor == ']') {
+				++cursor;
+				return true;
+			}
+			while (true) {
+				value.array.emplace_back();
+				if (!parseValue(value.array.back(), depth + 1)) {
+					return false;
+				}
+				skipWhitespace();
+				if (cursor != end && *cursor == ',') {
+					++cursor;
+				} else if (cursor != end && *cursor == ']') {
+					++cursor;
+					return true;
+				} else {
+					return fail("expected ',' or ']'");
+				}
+			}
+		}
+
+		static void appendUtf8(std::string& out, uint32_t codePoint) {
+			if (codePoint < 0x80) {
+				out += static_cast<char>(codePoint);
+			} else if (codePoint < 0x800) {
+				out += static_cast<char>(0xc0 | (codePoint >> 6));
+				out += static_cast<char>(0x80 | (codePoint & 0x3f));
+			} else if (codePoint < 0x10000) {
+				out += static_cast<char>(0xe0 | (codePoint >> 12));
+				out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+				out += static_cast<char>(0x80 | (codePoint & 0x3f));
+			} else {
+				out += static_cast<char>(0xf0 | (codePoint >> 18));
+				out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+				out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+				out += static_cast<char>(0x80 | (codePoint & 0x3f));
+			}
+		}
+
+		bool parseHex4(uint32_t& codeUnit) {
+			if (end - cursor < 4) {
+				return fail("truncated escape");
+			}
+			codeUnit = 0;
+			for (int i = 0; i < 4; ++i) {
+				char c = *cursor++;
+				codeUnit <<= 4;
+				if (c >= '0' && c <= '9') {
+					codeUnit |= static_cast<uint32_t>(c - '0');
+				} else if (c >= 'a' && c <= 'f') {
+					codeUnit |= static_cast<uint32_t>(c - 'a' + 10);
+				} else if (c >= 'A' && c <= 'F') {
+					codeUnit |= static_cast<uint32_t>(c - 'A' + 10);
+				} else {
+					return fail("invalid escape");
+				}
+			}
+			return true;
+		}
+
+		bool parseString(std::string& out) {
+			++cursor;
+			while (cursor != end && *cursor != '"') {
+				char c = *cursor++;
+				if (c != '\\') {
+					out += c;
+					continue;
+				}
+				if (cursor == end) {
+					break;
+				}
+				char escape = *cursor++;
+				switch (escape) {
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u': {
+					uint32_t codePoint;
+					if (!parseHex4(codePoint)) {
+						return false;
+					}
+					// a surrogate pair spells one code point above the BMP
+					if (codePoint >= 0xd800 && codePoint < 0xdc00 && end - cursor >= 2 && cursor[0] == '\\' && cursor[1] == 'u') {
+						cursor += 2;
+						uint32_t low;
+						if (!parseHex4(low)) {
+							return false;
+						}
+						codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+					}
+					appendUtf8(out, codePoint);
+					break;
+				}
+				default:
+					return fail("invalid escape");
+				}
+			}
+			if (cursor == end) {
+				return fail("unterminated string");
+			}
+			++cursor;
+			return true;
+		}
+
+		bool parseNumber(JsonValue& value) {
+			// strtod would stop at the end of the number, but the text isn't terminated, so copy it out
+			const char* start = cursor;
+			while (cursor != end && ((*cursor != '\0' && strchr("+-.eE", *cursor) != nullptr) || (*cursor >= '0' && *cursor <= '9'))) {
+				++cursor;
+			}
+			std::string digits(start, cursor);
+			char* parsedEnd = nullptr;
+			value.type = JsonValue::Type::Number;
+			value.number = strtod(digits.c_str(), &parsedEnd);
+			if (digits.empty() || parsedEnd != digits.c_str() + digits.size()) {
+				cursor = start;
+				return fail("invalid number");
+			}
+			return true;
+		}
+
+		const char* cursor;
+		const char* begin;
+		const char* end;
+		std::string message;
+	};
+
+}
+
+const JsonValue* JsonValue::find(const char* key) const {
+	for (const JsonMember& member : object) {
+		if (member.key == key) {
+			return &member.value;
+		}
+	}
+	return nullptr;
+}
+
+double JsonValue::getNumber(const char* key, double fallback) const {
+	const JsonValue* value = find(key);
+	return value != nullptr && value->type == Type::Number ? value->number : fallback;
+}
+
+const std::string& JsonValue::getString(const char* key) const {
+	static const std::string empty;
+	const JsonValue* value = find(key);
+	return value != nullptr && value->type == Type::String ? value->string : empty;
+}
+
+const std::vector<JsonValue>& JsonValue::getArray(const char* key) const {
+	static const std::vector<JsonValue> empty;
+	const JsonValue* value = find(key);
+	return value != nullptr && value->type == Type::Array ? value->array : empty;
+}
+
+bool parseJson(const char* text, size_t length, JsonValue& value, std::string& error) {
+	value = JsonValue();
+	JsonParser parser(text, length);
+	return parser.parseDocument(value, error);
+}
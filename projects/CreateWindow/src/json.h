@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+struct JsonMember;
+
+// Just enough JSON for glTF: the document is read into a tree once, then queried.
+// Numbers are doubles, which holds every integer glTF uses exactly.
+struct JsonValue {
+	enum class Type {
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Type type = Type::Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<JsonMember> object;
+
+	// nullptr unless this is an object with key
+	const JsonValue* find(const char* key) const;
+	// fallback unless this is an object whose key holds the right type
+	double getNumber(const char* key, double fallback) const;
+	const std::string& getString(const char* key) const;
+	// the array under key, empty unless there is one
+	const std::vector<JsonValue>& getArray(const char* key) const;
+};
+
+struct JsonMember {
+	std::string key;
+	JsonValue value;
+};
+
+// false, with the offset of the problem in error, unless text is one valid JSON value
+bool parseJson(const char* text, size_t length, JsonValue& value, std::string& error);
@@ -1,24 +1,13 @@
 #pragma once
 
+#include "trace.h"
+
+// FUNCNAME() records the enclosing function as a trace zone, see trace.h
+#define FUNCNAME() TRACE_ZONE(TRACE_CATEGORY_FUNCTION, __FUNCTION__)
+
 #ifdef _DEBUG
-#include <string>
 #include <iostream>
-static int __tabCount = 0;
-static std::string __tabString = "";
-#define LOG(x) { std::cout << __tabString << x << std::endl; }
-#define FUNCNAME() LogFuncName __logFuncName(__FUNCTION__);
-#define TAB() { __tabCount++; __tabString = std::string(__tabCount, '\t'); }
-#define UNTAB() { __tabCount--; __tabString = std::string(__tabCount, '\t'); }
-struct LogFuncName {
-	LogFuncName(const char* fname) {
-		LOG(fname)
-			TAB()
-	}
-	~LogFuncName() { UNTAB() }
-};
+#define LOG(x) { std::cout << x << '\n'; }
 #else
 #define LOG(x) {}
-#define FUNCNAME() {}
-#define TAB() {}
-#define UNTAB() {}
-#endif
\ No newline at end of file
+#endif
@@ -1,13 +1,80 @@
 #include "app.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static void printUsage(const char* program) {
+	std::cerr << "usage: " << program << " [options]\n"
+		<< "\t--headless             render offscreen without a window\n"
+		<< "\t--frames N             stop after N frames\n"
+		<< "\t--frames-in-flight N   2 or 3\n"
+		<< "\t--size WxH             offscreen image size (headless)\n"
+		<< "\t--readback FILE        save the last frame, e.g. frame.png (headless)\n"
+		<< "\t--gpu-csv FILE         write GPU timings of every frame as CSV\n"
+		<< "\t--trace FILE           write CPU trace zones as Chrome trace-event JSON\n"
+		<< "\t--texture FILE         texture to draw; .ctex/.dds/.ktx2 are uploaded as stored\n"
+		<< "\t--mesh FILE            .gltf/.glb/.obj model to draw; imported once into FILE.cmesh\n"
+		<< "\t--packed-vertices      16-byte vertices: positions quantized to the mesh bounds, RGBA8 colors, half UVs\n"
+		<< "\t--compare-vertex-layouts\n"
+		<< "\t                       draw the mesh with float and packed vertices, each in its own GPU scope\n"
+		<< "\t--no-host-image-copy   upload textures through staging buffers even with VK_EXT_host_image_copy\n"
+		<< "\t--texture-budget MB    device memory for textures; by default the driver's memory budget\n"
+		<< "\t--tiled FILE           pan (arrows/WASD) and zoom (Q/E) over an image of any size;\n"
+		<< "\t                       a .tiles pyramid is built next to FILE unless it is one" << std::endl;
+}
 
 int main(int argc, char** argv) {
-	static_cast<void>(argc);
-	static_cast<void>(argv);
+	AppConfig config;
+	for (int i = 1; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--headless") == 0) {
+			config.headless = true;
+		} else if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+			config.frameCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		} else if (strcmp(argv[i], "--frames-in-flight") == 0 && hasValue) {
+			config.framesInFlight = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		} else if (strcmp(argv[i], "--size") == 0 && hasValue) {
+			char* end;
+			config.extent.width = static_cast<uint32_t>(strtoul(argv[++i], &end, 10));
+			config.extent.height = *end == 'x' ? static_cast<uint32_t>(strtoul(end + 1, nullptr, 10)) : 0;
+			if (config.extent.width == 0 || config.extent.height == 0) {
+				printUsage(argv[0]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--readback") == 0 && hasValue) {
+			config.readbackPath = argv[++i];
+		} else if (strcmp(argv[i], "--gpu-csv") == 0 && hasValue) {
+			config.gpuTimingCsvPath = argv[++i];
+		} else if (strcmp(argv[i], "--trace") == 0 && hasValue) {
+			config.tracePath = argv[++i];
+		} else if (strcmp(argv[i], "--texture") == 0 && hasValue) {
+			config.texturePath = argv[++i];
+		} else if (strcmp(argv[i], "--mesh") == 0 && hasValue) {
+			config.meshPath = argv[++i];
+		} else if (strcmp(argv[i], "--packed-vertices") == 0) {
+			config.vertexLayout = VertexLayout::Packed;
+		} else if (strcmp(argv[i], "--compare-vertex-layouts") == 0) {
+			config.compareVertexLayouts = true;
+		} else if (strcmp(argv[i], "--no-host-image-copy") == 0) {
+			config.hostImageCopy = false;
+		} else if (strcmp(argv[i], "--texture-budget") == 0 && hasValue) {
+			config.textureBudget = strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+		} else if (strcmp(argv[i], "--tiled") == 0 && hasValue) {
+			config.tiledImagePath = argv[++i];
+		} else {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
 
-	Application app;
+	Application app(config);
 	app.run();
 
-	system("pause");
+#ifdef _WIN32
+	if (!config.headless) {
+		system("pause");
+	}
+#endif
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file, so loaders can copy straight out of the page cache.
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile() { close(); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// false when the file doesn't exist, is empty or can't be mapped
+	bool open(const char* filename);
+	void close();
+
+	inline const unsigned char* getData() const { return data; }
+	inline size_t getSize() const { return size; }
+
+private:
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
@@ -1,10 +1,14 @@
 #include "mesh.h"
 #include "log.h"
-#include "imageloader.h"
 #include "utils.h"
 #include "shader.h"
+#include "meshcache.h"
+#include <cstring>
+#include <algorithm>
+#include <iostream>
 
 /* triangle
+// drawn when no model is given
 static const std::vector<Vertex> vertices = {
 	{ { 0.0f, -0.5f },{ 1.0f, 0.0f, 0.0f }, {1.0f, 0.0f} },
 	{ { 0.5f, 0.5f },{ 0.0f, 1.0f, 0.0f }, {0.0f, 0.0f} },
@@ -12,6 +16,7 @@ static const std::vector<Vertex> vertices = {
 };
 */
 
+// drawn when no model is given
 static const std::vector<Vertex> vertices = {
 	{ { -0.5f, -0.5f, 0.0f },{ 1.0f, 0.0f, 0.0f },{ 0.0f, 0.0f } },
 	{ { 0.5f, -0.5f, 0.0f },{ 0.0f, 1.0f, 0.0f },{ 1.0f, 0.0f } },
@@ -37,193 +42,166 @@ struct TriangleUBO {
 void Mesh::destroy() {
 	FUNCNAME()
 	vkDestroySampler(device, textureSampler, nullptr);
-	vkDestroyImageView(device, textureImageView, nullptr);
-	vkDestroyImage(device, textureImage, nullptr);
-	vkFreeMemory(device, textureImageMemory, nullptr);
 	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
-	vkDestroyBuffer(device, vertexBuffer, nullptr);
-	vkFreeMemory(device, vertexBufferMemory, nullptr);
-	vkDestroyBuffer(device, indexBuffer, nullptr);
-	vkFreeMemory(device, indexBufferMemory, nullptr);
-	vkDestroyBuffer(device, uniformBuffer, nullptr);
-	vkFreeMemory(device, uniformBufferMemory, nullptr);
+	geometryPool->free(geometry);
 	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 	vkDestroyPipeline(device, graphicsPipeline, nullptr);
 }
 
-void Mesh::recreate(VkExtent2D swapChainExtent, VkRenderPass renderPass) {
-	createPipeline(swapChainExtent, renderPass);
+void Mesh::recreate(VkRenderPass renderPass) {
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyPipeline(device, graphicsPipeline, nullptr);
+	createPipeline(renderPass);
 }
 
-void Mesh::initialize(VkPhysicalDevice physDevice_, VkDevice device_,
-	VkCommandPool commandPool_, VkQueue graphicsQueue_,
-	VkExtent2D swapChainExtent, VkRenderPass renderPass)
+void Mesh::initialize(const DeviceInfo& deviceInfo_, VkDevice device_,
+	DeviceAllocator& allocator_, UniformRing& uniformRing_,
+	GeometryPool& geometryPool_, UploadBatch& upload, TextureLoader& textureLoader_,
+	VkPipelineCache pipelineCache_,
+	VkRenderPass renderPass,
+	const char* texturePath,
+	const char* meshPath,
+	VertexLayout layout)
 {
 	FUNCNAME()
-	physDevice = physDevice_;
+	deviceInfo = &deviceInfo_;
 	device = device_;
-	commandPool = commandPool_;
-	graphicsQueue = graphicsQueue_;
-	createBuffers();
-	createTextureAndSampler();
+	allocator = &allocator_;
+	uniformRing = &uniformRing_;
+	geometryPool = &geometryPool_;
+	textureLoader = &textureLoader_;
+	pipelineCache = pipelineCache_;
+	vertexLayout = layout;
+	texture = textureLoader->request(texturePath);
+	createBuffers(upload, meshPath);
+	createSampler();
 	createDescriptorSet();
-	createPipeline(swapChainExtent, renderPass);
+	createPipeline(renderPass);
 }
 
-void Mesh::createBuffers() {
-	// vertex buffer
-	{
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(physDevice, device,
-			bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer, stagingBufferMemory);
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, vertices.data(), (size_t)bufferSize);
-		vkUnmapMemory(device, stagingBufferMemory);
-		createBuffer(physDevice, device,
-			bufferSize,
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			vertexBuffer, vertexBufferMemory);
-		copyBuffer(device, commandPool, graphicsQueue, stagingBuffer, vertexBuffer, bufferSize);
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
-	}
-	// index buffer
-	{
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(physDevice, device, bufferSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer, stagingBufferMemory);
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
-		vkUnmapMemory(device, stagingBufferMemory);
-		createBuffer(physDevice, device, bufferSize,
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			indexBuffer, indexBufferMemory);
-		copyBuffer(device, commandPool, graphicsQueue, stagingBuffer, indexBuffer, bufferSize);
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
+void Mesh::createBuffers(UploadBatch& upload, const char* meshPath) {
+	MeshCache cache;
+	if (meshPath != nullptr && *meshPath != '\0') {
+		if (!cache.load(meshPath)) {
+			std::cerr << "Mesh: cannot load " << meshPath << ", drawing the default quads" << std::endl;
+		}
 	}
-	// uniform buffer
-	{
-		VkDeviceSize bufferSize = sizeof(TriangleUBO);
-		createBuffer(physDevice, device, bufferSize,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			uniformBuffer, uniformBufferMemory);
+	if (cache.getIndexCount() == 0) {
+		glm::vec3 boundsMin = vertices[0].pos;
+		glm::vec3 boundsMax = vertices[0].pos;
+		for (const Vertex& vertex : vertices) {
+			boundsMin = glm::min(boundsMin, vertex.pos);
+			boundsMax = glm::max(boundsMax, vertex.pos);
+		}
+		fitTransform = glm::mat4(1.0f);
+		submeshes = { { .firstIndex = 0, .indexCount = static_cast<uint32_t>(indices.size()), .vertexOffset = 0 } };
+		uploadGeometry(upload, vertices.data(), vertices.size(), boundsMin, boundsMax,
+			indices.data(), indices.size(), VK_INDEX_TYPE_UINT16);
+		return;
 	}
-}
-
-void Mesh::createTextureAndSampler() {
-	// load image for texturing
-	{
-		freeimage::ImageData imageData = freeimage::loadImage("../../resources/hob.jpg");
-		VkDeviceSize imageSize = imageData.width * imageData.height * 4;
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(physDevice, device, imageSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer, stagingBufferMemory);
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-		memcpy(data, imageData.buffer, static_cast<size_t>(imageSize));
-		vkUnmapMemory(device, stagingBufferMemory);
-
-		VkImageCreateInfo imageInfo {
-			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-			.flags = 0,
-			.imageType = VK_IMAGE_TYPE_2D,
-			.format = VK_FORMAT_B8G8R8A8_UNORM,
-			.extent = {
-				.width = static_cast<uint32_t>(imageData.width),
-				.height = static_cast<uint32_t>(imageData.height),
-				.depth = 1,
-			},
-			.mipLevels = 1,
-			.arrayLayers = 1,
-			.samples = VK_SAMPLE_COUNT_1_BIT,
-			.tiling = VK_IMAGE_TILING_OPTIMAL,
-			.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
-		};
 
-		if (vkCreateImage(device, &imageInfo, nullptr, &textureImage) != VK_SUCCESS) {
-			assert(0);
+	// models come in any unit; center them and scale the largest side to the size of the quads
+	glm::vec3 extent = cache.getBoundsMax() - cache.getBoundsMin();
+	float size = std::max(extent.x, std::max(extent.y, extent.z));
+	glm::vec3 center = (cache.getBoundsMin() + cache.getBoundsMax()) * 0.5f;
+	fitTransform = glm::scale(glm::mat4(1.0f), glm::vec3(size > 0.0f ? 1.0f / size : 1.0f));
+	fitTransform = glm::translate(fitTransform, -center);
+
+	// 16-bit indices halve the index buffer and its fetch. A model with more vertices than they reach
+	// is split into submeshes, each with its own copy of the vertices it uses, as long as the copies
+	// along the cuts cost less memory than the narrower indices save
+	const Vertex* meshVertices = cache.getVertices();
+	size_t vertexCount = cache.getVertexCount();
+	const uint32_t* meshIndices = cache.getIndices();
+	size_t indexCount = cache.getIndexCount();
+	const uint32_t narrowRange = 1u << 16;
+	// 2^24 - 1 at least; 2^32 - 1 with fullDrawIndexUint32, which the device enables when it can
+	uint64_t wideRange = static_cast<uint64_t>(deviceInfo->getLimits().maxDrawIndexedIndexValue) + 1;
+	size_t vertexSize = vertexLayout == VertexLayout::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+	std::vector<uint32_t> vertexSources;
+	std::vector<uint32_t> splitIndices;
+	bool narrow = vertexCount <= narrowRange;
+	submeshes = { { .firstIndex = 0, .indexCount = static_cast<uint32_t>(indexCount), .vertexOffset = 0 } };
+	if (!narrow) {
+		splitMesh(meshIndices, indexCount, narrowRange, submeshes, vertexSources, splitIndices);
+		narrow = vertexSources.size() * vertexSize + indexCount * sizeof(uint16_t)
+			< vertexCount * vertexSize + indexCount * sizeof(uint32_t);
+		if (!narrow && vertexCount <= wideRange) {
+			submeshes = { { .firstIndex = 0, .indexCount = static_cast<uint32_t>(indexCount), .vertexOffset = 0 } };
+			vertexSources.clear();
+		} else if (!narrow) {
+			splitMesh(meshIndices, indexCount, static_cast<uint32_t>(wideRange), submeshes, vertexSources, splitIndices);
 		}
-
-		VkMemoryRequirements memRequirements;
-		vkGetImageMemoryRequirements(device, textureImage, &memRequirements);
-		VkMemoryAllocateInfo allocInfo {
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = memRequirements.size,
-			.memoryTypeIndex = findMemoryType(physDevice,
-								memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-		};
-
-		if (vkAllocateMemory(device, &allocInfo, nullptr, &textureImageMemory) != VK_SUCCESS) {
-			assert(0);
+	}
+	std::vector<Vertex> splitVertices;
+	if (!vertexSources.empty()) {
+		splitVertices.resize(vertexSources.size());
+		for (size_t i = 0; i < vertexSources.size(); ++i) {
+			splitVertices[i] = meshVertices[vertexSources[i]];
 		}
-
-		vkBindImageMemory(device, textureImage, textureImageMemory, 0);
-
-		transitionImageLayout(textureImage,
-			VK_FORMAT_B8G8R8A8_UNORM,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		copyBufferToImage(stagingBuffer, textureImage,
-			static_cast<uint32_t>(imageData.width),
-			static_cast<uint32_t>(imageData.height));
-
-		transitionImageLayout(textureImage,
-			VK_FORMAT_B8G8R8A8_UNORM,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-		// cleanup
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
-		imageData.unload();
+		meshVertices = splitVertices.data();
+		vertexCount = splitVertices.size();
+		meshIndices = splitIndices.data();
 	}
-	{
-		textureImageView = createImageView(device, textureImage, VK_FORMAT_B8G8R8A8_UNORM,
-			VK_IMAGE_ASPECT_COLOR_BIT);
+	std::vector<uint16_t> narrowIndices;
+	if (narrow) {
+		narrowIndices.resize(indexCount);
+		for (size_t i = 0; i < indexCount; ++i) {
+			narrowIndices[i] = static_cast<uint16_t>(meshIndices[i]);
+		}
 	}
-	{
-		VkSamplerCreateInfo samplerInfo {
-			.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-			.magFilter = VK_FILTER_LINEAR,
-			.minFilter = VK_FILTER_LINEAR,
-			.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
-			.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-			.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-			.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-			.mipLodBias = 0.0f,
-			.anisotropyEnable = VK_TRUE,
-			.maxAnisotropy = 16,
-			.compareEnable = VK_FALSE,
-			.compareOp = VK_COMPARE_OP_ALWAYS,
-			.minLod = 0.0f,
-			.maxLod = 0.0f,
-			.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
-			.unnormalizedCoordinates = VK_FALSE
-		};
+	// unless it was split or narrowed, straight from the mapped cache into staging (or in place) memory
+	uploadGeometry(upload, meshVertices, vertexCount, cache.getBoundsMin(), cache.getBoundsMax(),
+		narrow ? static_cast<const void*>(narrowIndices.data()) : meshIndices, indexCount,
+		narrow ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+	std::cout << "Mesh: " << vertexCount << " vertices, " << (narrow ? 16 : 32) << "-bit indices in "
+		<< submeshes.size() << (submeshes.size() == 1 ? " draw" : " draws") << std::endl;
+}
 
-		if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
-			assert(0);
-		}
+void Mesh::uploadGeometry(UploadBatch& upload, const Vertex* source, size_t vertexCount,
+	const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+	const void* indexData, size_t indexCount, VkIndexType indexType) {
+	const void* vertexData = source;
+	uint32_t vertexStride = sizeof(Vertex);
+	std::vector<PackedVertex> packed;
+	if (vertexLayout == VertexLayout::Packed) {
+		TRACE_ZONE(TRACE_CATEGORY_RESOURCE, "pack vertices")
+		packed.resize(vertexCount);
+		packVertices(source, vertexCount, boundsMin, boundsMax, packed.data());
+		vertexData = packed.data();
+		vertexStride = sizeof(PackedVertex);
+		fitTransform = fitTransform * packedPositionTransform(boundsMin, boundsMax);
+	}
+	geometry = geometryPool->allocate(static_cast<uint32_t>(vertexCount), vertexStride,
+		static_cast<uint32_t>(indexCount), indexType);
+	geometryPool->upload(upload, geometry, vertexData, indexData);
+}
+
+void Mesh::createSampler() {
+	FUNCNAME()
+	// the texture's mip count isn't known until it has loaded, so the LOD is left unclamped
+	VkSamplerCreateInfo samplerInfo {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_LINEAR,
+		.minFilter = VK_FILTER_LINEAR,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.mipLodBias = 0.0f,
+		.anisotropyEnable = VK_TRUE,
+		.maxAnisotropy = 16,
+		.compareEnable = VK_FALSE,
+		.compareOp = VK_COMPARE_OP_ALWAYS,
+		.minLod = 0.0f,
+		.maxLod = VK_LOD_CLAMP_NONE,
+		.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+		.unnormalizedCoordinates = VK_FALSE
+	};
+
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
+		assert(0);
 	}
 }
 
@@ -231,20 +209,22 @@ void Mesh::createDescriptorSet() {
 	FUNCNAME()
 		// descriptor pool
 	{
+		// one set per frame in flight, so the texture binding can change while older frames still read theirs
+		uint32_t frameCount = uniformRing->getFrameCount();
 		VkDescriptorPoolSize poolSizes[2] {
 			{
-				.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				.descriptorCount = 1
+				.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.descriptorCount = frameCount
 			},
 			{
 				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				.descriptorCount = 1
+				.descriptorCount = frameCount
 			}
 		};
 
 		VkDescriptorPoolCreateInfo poolInfo {
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-			.maxSets = 1,
+			.maxSets = frameCount,
 			.poolSizeCount = 2,
 			.pPoolSizes = poolSizes
 		};
@@ -254,13 +234,11 @@ void Mesh::createDescriptorSet() {
 		}
 	}
 	{
-		VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-
 		VkDescriptorSetLayoutBinding bindings[2] = {
 			// uboLayoutBinding
 			{
 				.binding = 0,
-				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
 				.descriptorCount = 1,
 				.stageFlags = VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT,
 				.pImmutableSamplers = nullptr
@@ -286,31 +264,41 @@ void Mesh::createDescriptorSet() {
 			assert(0);
 		}
 	}
-	// descriptor set
+	// descriptor sets
 	{
-		VkDescriptorSetLayout layouts[] = { descriptorSetLayout };
+		std::vector<VkDescriptorSetLayout> layouts(uniformRing->getFrameCount(), descriptorSetLayout);
 		VkDescriptorSetAllocateInfo allocInfo {
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
 			.descriptorPool = descriptorPool,
-			.descriptorSetCount = 1,
-			.pSetLayouts = layouts
+			.descriptorSetCount = static_cast<uint32_t>(layouts.size()),
+			.pSetLayouts = layouts.data()
 		};
 
-		if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
+		descriptorSets.resize(layouts.size());
+		if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
 			assert(0);
 		}
+		boundImageViews.assign(layouts.size(), VK_NULL_HANDLE);
 	}
+	for (uint32_t frame = 0; frame < descriptorSets.size(); ++frame) {
+		updateDescriptorSet(frame);
+	}
+}
+
+void Mesh::updateDescriptorSet(uint32_t frame) {
+	VkDescriptorSet descriptorSet = descriptorSets[frame];
+	VkImageView imageView = textureLoader->getImageView(texture);
 	// update descriptor set
 	{
 		VkDescriptorBufferInfo bufferInfo {
-			.buffer = uniformBuffer,
+			.buffer = uniformRing->getBuffer(),
 			.offset = 0,
 			.range = sizeof(TriangleUBO)
 		};
 
 		VkDescriptorImageInfo imageInfo {
 			.sampler = textureSampler,
-			.imageView = textureImageView,
+			.imageView = imageView,
 			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 		};
 
@@ -321,7 +309,7 @@ void Mesh::createDescriptorSet() {
 				.dstBinding = 0,
 				.dstArrayElement = 0,
 				.descriptorCount = 1,
-				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
 				.pImageInfo = nullptr,
 				.pBufferInfo = &bufferInfo,
 				.pTexelBufferView = nullptr
@@ -342,6 +330,17 @@ void Mesh::createDescriptorSet() {
 		vkUpdateDescriptorSets(device, 2,
 			descriptorWrites, 0, nullptr);
 	}
+	boundImageViews[frame] = imageView;
+}
+
+void Mesh::beginFrame(uint32_t frame) {
+	currentFrame = frame;
+	textureLoader->touch(texture);
+	// the placeholder is swapped for the real texture once it is resident, and for a smaller or
+	// larger image whenever the loader drops or restores levels
+	if (boundImageViews[frame] != textureLoader->getImageView(texture)) {
+		updateDescriptorSet(frame);
+	}
 }
 
 void Mesh::updateUniformBuffer(VkExtent2D swapChainExtent) {
@@ -353,117 +352,29 @@ void Mesh::updateUniformBuffer(VkExtent2D swapChainExtent) {
 	//glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 	glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -2.0f));
 	
-	static float t = 0.0f;
-	t += 0.0001f;
-	glm::mat4 model = glm::rotate(glm::mat4(1.0f), t, glm::vec3(0.0f, 0.3f, 0.1f));
+	angle += 0.0001f;
+	glm::mat4 model = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 0.3f, 0.1f)) * fitTransform;
 
 	TriangleUBO ubo{};
 	ubo.mvp = proj * view * model;
 
-	// Not the most efficient way. Use push constants for more efficiency.
-	void* data;
-	vkMapMemory(device, uniformBufferMemory, 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(device, uniformBufferMemory);
+	uniformOffset = uniformRing->push(&ubo, sizeof(ubo));
 }
 
-void Mesh::commitCommands(VkCommandBuffer commandBuffer) {
-	FUNCNAME()
+void Mesh::commitCommands(VkCommandBuffer commandBuffer, GeometryBinding& binding) {
 	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-		pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+		pipelineLayout, 0, 1, &descriptorSets[currentFrame], 1, &uniformOffset);
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 
-	VkBuffer vertexBuffers[] = { vertexBuffer };
-	VkDeviceSize offsets[] = { 0 };
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+	geometryPool->bind(commandBuffer, geometry, binding);
 	//vkCmdDraw(commandBuffer, static_cast<uint32_t>(vertices.size()), 1, 0, 0);
-	vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
-}
-
-void Mesh::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-	FUNCNAME()
-	static_cast<void>(format);
-
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
-	VkImageMemoryBarrier barrier {
-		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-		.oldLayout = oldLayout,
-		.newLayout = newLayout,
-		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.image = image,
-		.subresourceRange {
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1
-		}
-	};
-	
-	VkPipelineStageFlags sourceStage;
-	VkPipelineStageFlags destinationStage;
-
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	} else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	} else {
-		throw std::invalid_argument("unsupported layout transition!");
+	for (const Submesh& submesh : submeshes) {
+		vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, geometry.firstIndex + submesh.firstIndex,
+			static_cast<int32_t>(geometry.firstVertex + submesh.vertexOffset), 0);
 	}
-	
-	vkCmdPipelineBarrier(
-		commandBuffer,
-		sourceStage, destinationStage,
-		0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier
-	);
-	endSingleTimeCommands(device, commandPool, graphicsQueue, commandBuffer);
 }
 
-void Mesh::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-	FUNCNAME()
-
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
-
-	VkBufferImageCopy region {
-		.bufferOffset = 0,
-		.bufferRowLength = 0,
-		.bufferImageHeight = 0,
-		.imageSubresource = {
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.mipLevel = 0,
-			.baseArrayLayer = 0,
-			.layerCount = 1
-		},
-		.imageOffset = { 0, 0, 0 },
-		.imageExtent = { width, height, 1 }
-	};
-
-	vkCmdCopyBufferToImage(
-		commandBuffer,
-		buffer,
-		image,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1,
-		&region
-	);
-
-	endSingleTimeCommands(device, commandPool, graphicsQueue, commandBuffer);
-}
-
-void Mesh::createPipeline(VkExtent2D swapChainExtent, VkRenderPass renderPass) {
+void Mesh::createPipeline(VkRenderPass renderPass) {
 	FUNCNAME()
 	LOG("- load shaders")
 	Shader shader(device);
@@ -486,8 +397,8 @@ void Mesh::createPipeline(VkExtent2D swapChainExtent, VkRenderPass renderPass) {
 
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertexShaderStageInfo, fragmentShaderStageInfo };
 
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	auto bindingDescription = Vertex::getBindingDescription(vertexLayout);
+	auto attributeDescriptions = Vertex::getAttributeDescriptions(vertexLayout);
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
@@ -503,26 +414,20 @@ void Mesh::createPipeline(VkExtent2D swapChainExtent, VkRenderPass renderPass) {
 		.primitiveRestartEnable = VK_FALSE
 	};
 
-	VkViewport viewport {
-		.x = 0.0f,
-		.y = 0.0f,
-		.width = static_cast<float>(swapChainExtent.width),
-		.height = static_cast<float>(swapChainExtent.height),
-		.minDepth = 0.0f,
-		.maxDepth = 1.0f
-	};
-
-	VkRect2D scissor {
-		.offset = { 0, 0 },
-		.extent = swapChainExtent
-	};
-
+	// viewport and scissor are set at record time, so a resize never needs a new pipeline
 	VkPipelineViewportStateCreateInfo viewportState {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
 		.viewportCount = 1,
-		.pViewports = &viewport,
+		.pViewports = nullptr,
 		.scissorCount = 1,
-		.pScissors = &scissor
+		.pScissors = nullptr
+	};
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		.dynamicStateCount = 2,
+		.pDynamicStates = dynamicStates
 	};
 
 	VkPipelineRasterizationStateCreateInfo rasterizer {
@@ -606,7 +511,7 @@ void Mesh::createPipeline(VkExtent2D swapChainExtent, VkRenderPass renderPass) {
 		.pMultisampleState = &multisampling,
 		.pDepthStencilState = &depthStencil,
 		.pColorBlendState = &colorBlending,
-		.pDynamicState = nullptr,
+		.pDynamicState = &dynamicState,
 		.layout = pipelineLayout,
 		.renderPass = renderPass,
 		.subpass = 0,
@@ -614,7 +519,7 @@ void Mesh::createPipeline(VkExtent2D swapChainExtent, VkRenderPass renderPass) {
 		.basePipelineIndex = -1
 	};
 
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
 		assert(0);
 	}
 }
\ No newline at end of file
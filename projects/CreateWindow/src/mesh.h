@@ -1,84 +1,79 @@
 #pragma once
 
-// warning level 4
-// glm uses nameless structs and unions
-#pragma warning(disable : 4201)
-
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#include "glm/glm.hpp"
+#include "vertex.h"
+#include "meshoptimize.h"
 #include "glm/gtc/matrix_transform.hpp"
 
 #include "vulkan/vulkan.h"
+#include "deviceinfo.h"
+#include "allocator.h"
+#include "uniformring.h"
+#include "geometrypool.h"
+#include "upload.h"
+#include "textureloader.h"
 #include <vector>
 #include <array>
 
-struct Vertex {
-	glm::vec3 pos;
-	glm::vec3 color;
-	glm::vec2 texcoord;
-	static VkVertexInputBindingDescription getBindingDescription() {
-		VkVertexInputBindingDescription desc{};
-		desc.binding = 0;
-		desc.stride = sizeof(Vertex);
-		desc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		return desc;
-	}
-	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-		std::array<VkVertexInputAttributeDescription, 3> desc;
-		desc[0].binding = 0;
-		desc[0].location = 0;
-		desc[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		desc[0].offset = offsetof(Vertex, pos);
-		desc[1].binding = 0;
-		desc[1].location = 1;
-		desc[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		desc[1].offset = offsetof(Vertex, color);
-		desc[2].binding = 0;
-		desc[2].location = 2;
-		desc[2].format = VK_FORMAT_R32G32_SFLOAT;
-		desc[2].offset = offsetof(Vertex, texcoord);
-		return desc;
-	}
-};
-
 class Mesh {
 public:
 	void initialize(
-		VkPhysicalDevice physDevice,
+		const DeviceInfo& deviceInfo,
 		VkDevice device,
-		VkCommandPool commandPool,
-		VkQueue graphicsQueue,
-		VkExtent2D swapChainExtent,
-		VkRenderPass renderPass);
+		DeviceAllocator& allocator,
+		UniformRing& uniformRing,
+		GeometryPool& geometryPool,
+		UploadBatch& upload,
+		TextureLoader& textureLoader,
+		VkPipelineCache pipelineCache,
+		VkRenderPass renderPass,
+		const char* texturePath,
+		// .gltf, .glb or .obj, cached as .cmesh on first use; nullptr or empty draws two quads
+		const char* meshPath = nullptr,
+		VertexLayout layout = VertexLayout::Float);
+	// call once the frame's fence has signaled; refreshes that frame's descriptor set if needed
+	void beginFrame(uint32_t frame);
 	void updateUniformBuffer(VkExtent2D swapChainExtent);
-	void commitCommands(VkCommandBuffer commandBuffer);
+	// binds the geometry pool's page only when binding says another one is bound
+	void commitCommands(VkCommandBuffer commandBuffer, GeometryBinding& binding);
 	void destroy();
-	void recreate(VkExtent2D swapChainExtent, VkRenderPass renderPass);
+	// only needed when the render pass changes; a resize alone keeps the pipeline
+	void recreate(VkRenderPass renderPass);
 	inline VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
-	void createPipeline(VkExtent2D swapChainExtent, VkRenderPass renderPass);
+	void createPipeline(VkRenderPass renderPass);
 private:
-	void createBuffers();
-	void createTextureAndSampler();
+	void createBuffers(UploadBatch& upload, const char* meshPath);
+	// into a range of the geometry pool, the vertices in vertexLayout; fitTransform has to be set already
+	void uploadGeometry(UploadBatch& upload, const Vertex* source, size_t vertexCount,
+		const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+		const void* indexData, size_t indexCount, VkIndexType indexType);
+	void createSampler();
 	void createDescriptorSet();
-	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+	void updateDescriptorSet(uint32_t frame);
 	// association
-	VkPhysicalDevice physDevice;
+	const DeviceInfo* deviceInfo;
 	VkDevice device;
-	VkCommandPool commandPool;
-	VkQueue graphicsQueue;
+	DeviceAllocator* allocator;
+	UniformRing* uniformRing;
+	GeometryPool* geometryPool;
+	TextureLoader* textureLoader;
+	VkPipelineCache pipelineCache;
 	// composition
-	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
-	VkBuffer indexBuffer;
-	VkDeviceMemory indexBufferMemory;
-	VkBuffer uniformBuffer;
-	VkDeviceMemory uniformBufferMemory;
+	GeometryRange geometry;
+	// one draw each, relative to geometry; more than one only for meshes too large for its index type
+	std::vector<Submesh> submeshes;
+	VertexLayout vertexLayout = VertexLayout::Float;
+	// centers the model and scales it to about one unit; with packed vertices it also
+	// dequantizes their positions, so it all ends up in the one MVP
+	glm::mat4 fitTransform { 1.0f };
+	float angle = 0.0f;
+	// offset of this frame's constants in uniformRing
+	uint32_t uniformOffset = 0;
 	VkDescriptorSetLayout descriptorSetLayout;
-	VkDescriptorSet descriptorSet;
-	VkImage textureImage;
-	VkDeviceMemory textureImageMemory;
-	VkImageView textureImageView;
+	// one per frame in flight, each remembering the view it was written with
+	std::vector<VkDescriptorSet> descriptorSets;
+	std::vector<VkImageView> boundImageViews;
+	uint32_t currentFrame = 0;
+	TextureHandle texture = TextureLoader::PLACEHOLDER;
 	VkSampler textureSampler;
 
 	VkPipelineLayout pipelineLayout;
@@ -0,0 +1,226 @@
+#include "meshcache.h"
+#include "meshoptimize.h"
+#include "log.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+
+namespace {
+
+	uint64_t alignOffset(uint64_t offset) {
+		return (offset + MESH_CACHE_ALIGNMENT - 1) & ~static_cast<uint64_t>(MESH_CACHE_ALIGNMENT - 1);
+	}
+
+	// FNV-1a; only has to notice that a file changed, not resist anyone
+	uint64_t hashBytes(const unsigned char* data, size_t size) {
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ data[i]) * 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	bool statFile(const std::string& path, uint64_t& size, uint64_t& modified) {
+		std::error_code error;
+		size = std::filesystem::file_size(path, error);
+		if (error) {
+			return false;
+		}
+		modified = static_cast<uint64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+		return !error;
+	}
+
+	void computeBounds(const std::vector<Vertex>& vertices, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+		boundsMin = boundsMax = vertices.empty() ? glm::vec3(0.0f) : vertices[0].pos;
+		for (const Vertex& vertex : vertices) {
+			boundsMin = glm::min(boundsMin, vertex.pos);
+			boundsMax = glm::max(boundsMax, vertex.pos);
+		}
+	}
+
+	bool hashFile(const std::string& path, uint64_t& hash) {
+		MappedFile file;
+		if (!file.open(path.c_str())) {
+			return false;
+		}
+		hash = hashBytes(file.getData(), file.getSize());
+		return true;
+	}
+
+}
+
+bool MeshCache::open(const char* filename) {
+	close();
+	if (!file.open(filename)) {
+		return false;
+	}
+	const unsigned char* data = file.getData();
+	size_t size = file.getSize();
+	MeshCacheHeader header;
+	if (size < sizeof(header)) {
+		close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION
+		|| header.vertexStride != sizeof(Vertex) || header.indexSize != sizeof(uint32_t)) {
+		std::cerr << "MeshCache: " << filename << " is not a version " << MESH_CACHE_VERSION << " mesh cache" << std::endl;
+		close();
+		return false;
+	}
+	uint64_t vertexBytes = header.vertexCount * sizeof(Vertex);
+	uint64_t indexBytes = header.indexCount * sizeof(uint32_t);
+	if (header.vertexOffset % MESH_CACHE_ALIGNMENT != 0 || header.indexOffset % MESH_CACHE_ALIGNMENT != 0
+		|| header.vertexCount > size / sizeof(Vertex) || header.indexCount > size / sizeof(uint32_t)
+		|| header.vertexOffset > size || size - header.vertexOffset < vertexBytes
+		|| header.indexOffset > size || size - header.indexOffset < indexBytes) {
+		std::cerr << "MeshCache: " << filename << " is corrupt" << std::endl;
+		close();
+		return false;
+	}
+
+	size_t offset = sizeof(header);
+	for (uint32_t i = 0; i < header.sourceCount; ++i) {
+		MeshCacheSource source;
+		if (size - offset < sizeof(source)) {
+			close();
+			return false;
+		}
+		memcpy(&source, data + offset, sizeof(source));
+		offset += sizeof(source);
+		if (size - offset < source.pathLength) {
+			close();
+			return false;
+		}
+		std::string path(reinterpret_cast<const char*>(data + offset), source.pathLength);
+		offset += source.pathLength;
+
+		uint64_t sourceSize;
+		uint64_t modified;
+		uint64_t hash;
+		bool stale = !statFile(path, sourceSize, modified) || sourceSize != source.size
+			|| (modified != source.modified && (!hashFile(path, hash) || hash != source.hash));
+		if (stale) {
+			close();
+			return false;
+		}
+	}
+
+	// splitMesh() and the draw index straight into the vertices, so one bad index is a corrupt cache
+	const uint32_t* cachedIndices = reinterpret_cast<const uint32_t*>(data + header.indexOffset);
+	for (uint64_t i = 0; i < header.indexCount; ++i) {
+		if (cachedIndices[i] >= header.vertexCount) {
+			std::cerr << "MeshCache: " << filename << " is corrupt" << std::endl;
+			close();
+			return false;
+		}
+	}
+
+	vertices = reinterpret_cast<const Vertex*>(data + header.vertexOffset);
+	indices = cachedIndices;
+	vertexCount = static_cast<size_t>(header.vertexCount);
+	indexCount = static_cast<size_t>(header.indexCount);
+	boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	return true;
+}
+
+bool MeshCache::load(const char* modelFilename) {
+	FUNCNAME()
+	std::string cachePath = meshCachePath(modelFilename);
+	if (open(cachePath.c_str())) {
+		return true;
+	}
+	std::cout << "importing " << modelFilename << std::endl;
+	MeshData mesh;
+	if (!importMesh(modelFilename, mesh)) {
+		return false;
+	}
+	MeshOptimizeSettings settings;
+	MeshOptimizeReport report = optimizeMesh(mesh, settings);
+	std::cout << "optimized " << modelFilename << " (" << settings.cacheSize << " entry FIFO, "
+		<< report.clusterCount << " clusters): ACMR " << report.before.acmr << " -> " << report.after.acmr
+		<< ", ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
+	if (writeMeshCache(cachePath.c_str(), mesh) && open(cachePath.c_str())) {
+		return true;
+	}
+	// e.g. a read-only directory: draw it anyway, the next run imports it again
+	std::cerr << "MeshCache: cannot cache " << modelFilename << " in " << cachePath << std::endl;
+	imported = std::move(mesh);
+	vertices = imported.vertices.data();
+	indices = imported.indices.data();
+	vertexCount = imported.vertices.size();
+	indexCount = imported.indices.size();
+	computeBounds(imported.vertices, boundsMin, boundsMax);
+	return true;
+}
+
+void MeshCache::close() {
+	file.close();
+	imported = MeshData();
+	vertices = nullptr;
+	indices = nullptr;
+	vertexCount = 0;
+	indexCount = 0;
+	boundsMin = boundsMax = glm::vec3(0.0f);
+}
+
+bool writeMeshCache(const char* filename, const MeshData& mesh) {
+	TRACE_ZONE(TRACE_CATEGORY_RESOURCE, "write mesh cache")
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	computeBounds(mesh.vertices, boundsMin, boundsMax);
+
+	std::vector<MeshCacheSource> sources(mesh.sources.size());
+	uint64_t sourcesSize = 0;
+	for (size_t i = 0; i < mesh.sources.size(); ++i) {
+		const std::string& path = mesh.sources[i];
+		MeshCacheSource& source = sources[i];
+		source.pathLength = static_cast<uint32_t>(path.size());
+		source.reserved = 0;
+		if (!statFile(path, source.size, source.modified) || !hashFile(path, source.hash)) {
+			std::cerr << "writeMeshCache(): cannot read " << path << std::endl;
+			return false;
+		}
+		sourcesSize += sizeof(source) + path.size();
+	}
+
+	MeshCacheHeader header {
+		.magic = MESH_CACHE_MAGIC,
+		.version = MESH_CACHE_VERSION,
+		.vertexStride = sizeof(Vertex),
+		.indexSize = sizeof(uint32_t),
+		.vertexCount = mesh.vertices.size(),
+		.indexCount = mesh.indices.size(),
+		.vertexOffset = alignOffset(sizeof(MeshCacheHeader) + sourcesSize),
+		.indexOffset = 0,
+		.boundsMin = { boundsMin.x, boundsMin.y, boundsMin.z },
+		.boundsMax = { boundsMax.x, boundsMax.y, boundsMax.z },
+		.sourceCount = static_cast<uint32_t>(sources.size()),
+		.reserved = 0
+	};
+	header.indexOffset = alignOffset(header.vertexOffset + mesh.vertices.size() * sizeof(Vertex));
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "writeMeshCache(): cannot write " << filename << std::endl;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (size_t i = 0; i < sources.size(); ++i) {
+		file.write(reinterpret_cast<const char*>(&sources[i]), sizeof(sources[i]));
+		file.write(mesh.sources[i].data(), mesh.sources[i].size());
+	}
+	static const char padding[MESH_CACHE_ALIGNMENT] = {};
+	file.write(padding, static_cast<std::streamsize>(header.vertexOffset - static_cast<uint64_t>(file.tellp())));
+	file.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+	file.write(padding, static_cast<std::streamsize>(header.indexOffset - static_cast<uint64_t>(file.tellp())));
+	file.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+	return file.good();
+}
+
+std::string meshCachePath(const char* modelFilename) {
+	return std::string(modelFilename) + ".cmesh";
+}
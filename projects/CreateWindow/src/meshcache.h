@@ -0,0 +1,76 @@
+#pragma once
+
+#include "meshimport.h"
+#include "mappedfile.h"
+#include <cstdint>
+
+// Imported meshes are optimized (see meshoptimize.h) and cached in a .cmesh file next to the model,
+// so later runs map it and copy the vertices and indices straight into staging memory instead of
+// parsing text again.
+// Layout: MeshCacheHeader, sourceCount MeshCacheSource records each followed by its path, then the
+// vertices and the 32-bit indices, each at a MESH_CACHE_ALIGNMENT aligned file offset.
+// Vertices are stored as Vertex is laid out in memory; bump MESH_CACHE_VERSION when it or what the
+// import does changes. Version 2 caches are optimized for the vertex cache.
+
+const uint32_t MESH_CACHE_MAGIC = 0x48534d43; // "CMSH"
+const uint32_t MESH_CACHE_VERSION = 2;
+const uint32_t MESH_CACHE_ALIGNMENT = 64;
+
+struct MeshCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexStride;
+	uint32_t indexSize;
+	uint64_t vertexCount;
+	uint64_t indexCount;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	float boundsMin[3];
+	float boundsMax[3];
+	uint32_t sourceCount;
+	uint32_t reserved;
+};
+
+// a file the cache was imported from. The size and modification time are compared first; only
+// when they differ is the content hashed, so a touched but unchanged file keeps its cache
+struct MeshCacheSource {
+	uint64_t size;
+	uint64_t modified;
+	uint64_t hash;
+	uint32_t pathLength;
+	uint32_t reserved;
+};
+
+// read side; the vertices and indices are paged in from the file on first access
+class MeshCache {
+public:
+	// opens the cache of modelFilename, importing the model and writing the cache first when it is
+	// missing or stale. If the cache can't be written the imported mesh is kept in memory instead
+	bool load(const char* modelFilename);
+	// false when the file is missing, corrupt, of another version or stale
+	bool open(const char* filename);
+	void close();
+
+	inline size_t getVertexCount() const { return vertexCount; }
+	inline size_t getIndexCount() const { return indexCount; }
+	inline const Vertex* getVertices() const { return vertices; }
+	inline const uint32_t* getIndices() const { return indices; }
+	inline const glm::vec3& getBoundsMin() const { return boundsMin; }
+	inline const glm::vec3& getBoundsMax() const { return boundsMax; }
+
+private:
+	MappedFile file;
+	// only used when the cache couldn't be written
+	MeshData imported;
+	const Vertex* vertices = nullptr;
+	const uint32_t* indices = nullptr;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	glm::vec3 boundsMin { 0.0f };
+	glm::vec3 boundsMax { 0.0f };
+};
+
+bool writeMeshCache(const char* filename, const MeshData& mesh);
+
+// where the cache of a model lives: the model's name with .cmesh appended
+std::string meshCachePath(const char* modelFilename);
@@ -0,0 +1,606 @@
+#include "meshimport.h"
+#include "mappedfile.h"
+#include "json.h"
+#include "log.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+	const uint32_t GLB_MAGIC = 0x46546c67; // "glTF"
+	const uint32_t GLB_CHUNK_JSON = 0x4e4f534a;
+	const uint32_t GLB_CHUNK_BIN = 0x004e4942;
+	const uint32_t GLTF_TRIANGLES = 4;
+	// node trees are acyclic in valid files; this stops broken ones
+	const int MAX_NODE_DEPTH = 64;
+
+	bool hasSuffix(const char* filename, const char* suffix) {
+		size_t length = strlen(filename);
+		size_t suffixLength = strlen(suffix);
+		if (length < suffixLength) {
+			return false;
+		}
+		for (size_t i = 0; i < suffixLength; ++i) {
+			if (tolower(static_cast<unsigned char>(filename[length - suffixLength + i])) != suffix[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// the directory part including the separator, empty for a bare file name
+	std::string directoryOf(const std::string& path) {
+		size_t separator = path.find_last_of("/\\");
+		return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+	}
+
+	// front faces are clockwise in this renderer, both formats store counter-clockwise ones
+	void addTriangle(MeshData& mesh, uint32_t a, uint32_t b, uint32_t c) {
+		mesh.indices.push_back(a);
+		mesh.indices.push_back(c);
+		mesh.indices.push_back(b);
+	}
+
+	// Wavefront .obj
+
+	bool importObj(const char* filename, MeshData& mesh) {
+		MappedFile file;
+		if (!file.open(filename)) {
+			std::cerr << "importMesh(): cannot read " << filename << std::endl;
+			return false;
+		}
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> colors;
+		std::vector<glm::vec2> texcoords;
+		// (position, texcoord) pairs already emitted; normals aren't part of Vertex
+		std::unordered_map<uint64_t, uint32_t> emitted;
+		std::vector<uint32_t> face;
+
+		const char* text = reinterpret_cast<const char*>(file.getData());
+		size_t size = file.getSize();
+		std::string line;
+		uint32_t lineNumber = 0;
+		for (size_t begin = 0; begin < size;) {
+			size_t end = begin;
+			while (end < size && text[end] != '\n') {
+				++end;
+			}
+			// the mapping isn't terminated, strtof needs it to be
+			line.assign(text + begin, end - begin);
+			begin = end + 1;
+			++lineNumber;
+
+			const char* cursor = line.c_str();
+			while (*cursor == ' ' || *cursor == '\t') {
+				++cursor;
+			}
+			char* next;
+			if (cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+				// x y z, optionally followed by r g b
+				float values[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+				cursor += 2;
+				for (int i = 0; i < 6; ++i) {
+					float value = strtof(cursor, &next);
+					if (next == cursor) {
+						break;
+					}
+					values[i] = value;
+					cursor = next;
+				}
+				positions.push_back({ values[0], values[1], values[2] });
+				colors.push_back({ values[3], values[4], values[5] });
+			} else if (cursor[0] == 'v' && cursor[1] == 't' && (cursor[2] == ' ' || cursor[2] == '\t')) {
+				float u = strtof(cursor + 3, &next);
+				float v = strtof(next, &next);
+				texcoords.push_back({ u, 1.0f - v });
+			} else if (cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+				face.clear();
+				cursor += 2;
+				while (true) {
+					long position = strtol(cursor, &next, 10);
+					if (next == cursor) {
+						break;
+					}
+					cursor = next;
+					long texcoord = 0;
+					if (*cursor == '/') {
+						++cursor;
+						if (*cursor != '/') {
+							texcoord = strtol(cursor, &next, 10);
+							cursor = next;
+						}
+						if (*cursor == '/') {
+							strtol(cursor + 1, &next, 10);
+							cursor = next;
+						}
+					}
+					// 1-based; negative indices count back from the latest element
+					long positionIndex = position > 0 ? position - 1 : static_cast<long>(positions.size()) + position;
+					long texcoordIndex = texcoord > 0 ? texcoord - 1
+						: texcoord < 0 ? static_cast<long>(texcoords.size()) + texcoord : -1;
+					if (positionIndex < 0 || positionIndex >= static_cast<long>(positions.size())
+						|| texcoordIndex >= static_cast<long>(texcoords.size()) || (texcoord != 0 && texcoordIndex < 0)) {
+						std::cerr << "importMesh(): " << filename << ":" << lineNumber << " has an index out of range" << std::endl;
+						return false;
+					}
+					uint64_t key = (static_cast<uint64_t>(positionIndex) << 32) | static_cast<uint32_t>(texcoordIndex + 1);
+					auto found = emitted.find(key);
+					if (found == emitted.end()) {
+						found = emitted.emplace(key, static_cast<uint32_t>(mesh.vertices.size())).first;
+						mesh.vertices.push_back({
+							positions[positionIndex],
+							colors[positionIndex],
+							texcoordIndex >= 0 ? texcoords[texcoordIndex] : glm::vec2(0.0f)
+						});
+					}
+					face.push_back(found->second);
+				}
+				// polygons are convex by the spec, a fan covers them
+				for (size_t i = 1; i + 1 < face.size(); ++i) {
+					addTriangle(mesh, face[0], face[i], face[i + 1]);
+				}
+			}
+		}
+		mesh.sources.push_back(filename);
+		return true;
+	}
+
+	// glTF 2.0
+
+	struct GltfDocument {
+		JsonValue json;
+		std::vector<std::vector<unsigned char>> buffers;
+		std::string directory;
+		bool warnedMode = false;
+	};
+
+	// a validated accessor: count elements of components each, stride bytes apart
+	struct GltfAccessor {
+		const unsigned char* data;
+		size_t count;
+		size_t stride;
+		uint32_t componentType;
+		uint32_t components;
+		bool normalized;
+	};
+
+	uint32_t componentSize(uint32_t componentType) {
+		switch (componentType) {
+		case 5120: // BYTE
+		case 5121: // UNSIGNED_BYTE
+			return 1;
+		case 5122: // SHORT
+		case 5123: // UNSIGNED_SHORT
+			return 2;
+		case 5125: // UNSIGNED_INT
+		case 5126: // FLOAT
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	uint32_t typeComponents(const std::string& type) {
+		if (type == "SCALAR") {
+			return 1;
+		} else if (type == "VEC2") {
+			return 2;
+		} else if (type == "VEC3") {
+			return 3;
+		} else if (type == "VEC4") {
+			return 4;
+		}
+		return 0;
+	}
+
+	bool decodeBase64(const char* text, size_t length, std::vector<unsigned char>& out) {
+		uint32_t bits = 0;
+		int bitCount = 0;
+		for (size_t i = 0; i < length && text[i] != '='; ++i) {
+			char c = text[i];
+			uint32_t value;
+			if (c >= 'A' && c <= 'Z') {
+				value = static_cast<uint32_t>(c - 'A');
+			} else if (c >= 'a' && c <= 'z') {
+				value = static_cast<uint32_t>(c - 'a' + 26);
+			} else if (c >= '0' && c <= '9') {
+				value = static_cast<uint32_t>(c - '0' + 52);
+			} else if (c == '+') {
+				value = 62;
+			} else if (c == '/') {
+				value = 63;
+			} else {
+				return false;
+			}
+			bits = (bits << 6) | value;
+			bitCount += 6;
+			if (bitCount >= 8) {
+				bitCount -= 8;
+				out.push_back(static_cast<unsigned char>(bits >> bitCount));
+			}
+		}
+		return true;
+	}
+
+	// relative URIs may escape characters, e.g. spaces as %20
+	std::string decodeUri(const std::string& uri) {
+		std::string path;
+		for (size_t i = 0; i < uri.size(); ++i) {
+			if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(static_cast<unsigned char>(uri[i + 1]))
+				&& isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+				path += static_cast<char>(strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+				i += 2;
+			} else {
+				path += uri[i];
+			}
+		}
+		return path;
+	}
+
+	bool loadBuffers(GltfDocument& doc, std::vector<unsigned char>& glbBinary, MeshData& mesh) {
+		const std::vector<JsonValue>& buffers = doc.json.getArray("buffers");
+		doc.buffers.resize(buffers.size());
+		for (size_t i = 0; i < buffers.size(); ++i) {
+			const std::string& uri = buffers[i].getString("uri");
+			size_t byteLength = static_cast<size_t>(buffers[i].getNumber("byteLength", 0.0));
+			std::vector<unsigned char>& data = doc.buffers[i];
+			if (uri.empty()) {
+				// the binary chunk of a .glb
+				if (i != 0) {
+					return false;
+				}
+				data.swap(glbBinary);
+			} else if (uri.compare(0, 5, "data:") == 0) {
+				size_t base64 = uri.find(";base64,");
+				if (base64 == std::string::npos
+					|| !decodeBase64(uri.c_str() + base64 + 8, uri.size() - base64 - 8, data)) {
+					return false;
+				}
+			} else {
+				std::string path = doc.directory + decodeUri(uri);
+				MappedFile file;
+				if (!file.open(path.c_str())) {
+					std::cerr << "importMesh(): cannot read " << path << std::endl;
+					return false;
+				}
+				data.assign(file.getData(), file.getData() + file.getSize());
+				mesh.sources.push_back(path);
+			}
+			if (data.size() < byteLength) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool getAccessor(const GltfDocument& doc, double index, GltfAccessor& accessor) {
+		const std::vector<JsonValue>& accessors = doc.json.getArray("accessors");
+		if (index < 0.0 || index >= static_cast<double>(accessors.size())) {
+			return false;
+		}
+		const JsonValue& json = accessors[static_cast<size_t>(index)];
+		if (json.find("sparse") != nullptr) {
+			std::cerr << "importMesh(): sparse accessors are not supported" << std::endl;
+			return false;
+		}
+		accessor.count = static_cast<size_t>(json.getNumber("count", 0.0));
+		accessor.componentType = static_cast<uint32_t>(json.getNumber("componentType", 0.0));
+		accessor.components = typeComponents(json.getString("type"));
+		const JsonValue* normalized = json.find("normalized");
+		accessor.normalized = normalized != nullptr && normalized->type == JsonValue::Type::Bool && normalized->boolean;
+		size_t elementSize = static_cast<size_t>(componentSize(accessor.componentType)) * accessor.components;
+		if (elementSize == 0) {
+			return false;
+		}
+
+		const std::vector<JsonValue>& views = doc.json.getArray("bufferViews");
+		double viewIndex = json.getNumber("bufferView", -1.0);
+		if (viewIndex < 0.0 || viewIndex >= static_cast<double>(views.size())) {
+			return false;
+		}
+		const JsonValue& view = views[static_cast<size_t>(viewIndex)];
+		double bufferIndex = view.getNumber("buffer", -1.0);
+		if (bufferIndex < 0.0 || bufferIndex >= static_cast<double>(doc.buffers.size())) {
+			return false;
+		}
+		const std::vector<unsigned char>& buffer = doc.buffers[static_cast<size_t>(bufferIndex)];
+		size_t offset = static_cast<size_t>(view.getNumber("byteOffset", 0.0) + json.getNumber("byteOffset", 0.0));
+		size_t viewLength = static_cast<size_t>(view.getNumber("byteLength", 0.0));
+		accessor.stride = static_cast<size_t>(view.getNumber("byteStride", 0.0));
+		if (accessor.stride == 0) {
+			accessor.stride = elementSize;
+		}
+		size_t viewEnd = static_cast<size_t>(view.getNumber("byteOffset", 0.0)) + viewLength;
+		if (accessor.count > 0
+			&& (viewEnd > buffer.size() || offset > viewEnd || viewEnd - offset < elementSize
+				|| (viewEnd - offset - elementSize) / accessor.stride < accessor.count - 1)) {
+			std::cerr << "importMesh(): accessor " << index << " lies outside its buffer" << std::endl;
+			return false;
+		}
+		accessor.data = buffer.data() + offset;
+		return true;
+	}
+
+	float readFloat(const GltfAccessor& accessor, size_t element, uint32_t component) {
+		const unsigned char* source = accessor.data + element * accessor.stride
+			+ component * componentSize(accessor.componentType);
+		switch (accessor.componentType) {
+		case 5120: {
+			int8_t value;
+			memcpy(&value, source, sizeof(value));
+			return accessor.normalized ? std::max(value / 127.0f, -1.0f) : value;
+		}
+		case 5121:
+			return accessor.normalized ? *source / 255.0f : *source;
+		case 5122: {
+			int16_t value;
+			memcpy(&value, source, sizeof(value));
+			return accessor.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+		}
+		case 5123: {
+			uint16_t value;
+			memcpy(&value, source, sizeof(value));
+			return accessor.normalized ? value / 65535.0f : value;
+		}
+		case 5125: {
+			uint32_t value;
+			memcpy(&value, source, sizeof(value));
+			return static_cast<float>(value);
+		}
+		default: {
+			float value;
+			memcpy(&value, source, sizeof(value));
+			return value;
+		}
+		}
+	}
+
+	uint32_t readIndex(const GltfAccessor& accessor, size_t element) {
+		const unsigned char* source = accessor.data + element * accessor.stride;
+		if (accessor.componentType == 5121) {
+			return *source;
+		} else if (accessor.componentType == 5123) {
+			uint16_t value;
+			memcpy(&value, source, sizeof(value));
+			return value;
+		}
+		uint32_t value;
+		memcpy(&value, source, sizeof(value));
+		return value;
+	}
+
+	bool addPrimitive(GltfDocument& doc, const JsonValue& primitive, const glm::mat4& transform, MeshData& mesh) {
+		if (static_cast<uint32_t>(primitive.getNumber("mode", GLTF_TRIANGLES)) != GLTF_TRIANGLES) {
+			if (!doc.warnedMode) {
+				std::cerr << "importMesh(): skipping primitives that aren't triangle lists" << std::endl;
+				doc.warnedMode = true;
+			}
+			return true;
+		}
+		const JsonValue* attributes = primitive.find("attributes");
+		GltfAccessor positions;
+		if (attributes == nullptr || !getAccessor(doc, attributes->getNumber("POSITION", -1.0), positions)
+			|| positions.components != 3) {
+			return false;
+		}
+		GltfAccessor texcoords {};
+		bool hasTexcoords = attributes->find("TEXCOORD_0") != nullptr;
+		if (hasTexcoords && (!getAccessor(doc, attributes->getNumber("TEXCOORD_0", -1.0), texcoords)
+			|| texcoords.components != 2 || texcoords.count != positions.count)) {
+			return false;
+		}
+		GltfAccessor colors {};
+		bool hasColors = attributes->find("COLOR_0") != nullptr;
+		if (hasColors && (!getAccessor(doc, attributes->getNumber("COLOR_0", -1.0), colors)
+			|| colors.components < 3 || colors.count != positions.count)) {
+			return false;
+		}
+
+		size_t base = mesh.vertices.size();
+		for (size_t i = 0; i < positions.count; ++i) {
+			glm::vec4 position(readFloat(positions, i, 0), readFloat(positions, i, 1), readFloat(positions, i, 2), 1.0f);
+			mesh.vertices.push_back({
+				glm::vec3(transform * position),
+				hasColors ? glm::vec3(readFloat(colors, i, 0), readFloat(colors, i, 1), readFloat(colors, i, 2)) : glm::vec3(1.0f),
+				hasTexcoords ? glm::vec2(readFloat(texcoords, i, 0), readFloat(texcoords, i, 1)) : glm::vec2(0.0f)
+			});
+		}
+
+		std::vector<uint32_t> indices;
+		if (primitive.find("indices") != nullptr) {
+			GltfAccessor indexAccessor;
+			// glTF indices are UNSIGNED_BYTE, UNSIGNED_SHORT or UNSIGNED_INT, which readIndex() expects
+			if (!getAccessor(doc, primitive.getNumber("indices", -1.0), indexAccessor) || indexAccessor.components != 1
+				|| (indexAccessor.componentType != 5121 && indexAccessor.componentType != 5123
+					&& indexAccessor.componentType != 5125)) {
+				return false;
+			}
+			indices.resize(indexAccessor.count);
+			for (size_t i = 0; i < indexAccessor.count; ++i) {
+				indices[i] = readIndex(indexAccessor, i);
+				if (indices[i] >= positions.count) {
+					std::cerr << "importMesh(): index out of range" << std::endl;
+					return false;
+				}
+			}
+		} else {
+			indices.resize(positions.count);
+			for (size_t i = 0; i < positions.count; ++i) {
+				indices[i] = static_cast<uint32_t>(i);
+			}
+		}
+		// a mirroring transform turns the winding around as well
+		bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			uint32_t a = static_cast<uint32_t>(base + indices[i]);
+			uint32_t b = static_cast<uint32_t>(base + indices[i + 1]);
+			uint32_t c = static_cast<uint32_t>(base + indices[i + 2]);
+			if (mirrored) {
+				addTriangle(mesh, a, c, b);
+			} else {
+				addTriangle(mesh, a, b, c);
+			}
+		}
+		return true;
+	}
+
+	glm::mat4 nodeTransform(const JsonValue& node) {
+		const std::vector<JsonValue>& matrix = node.getArray("matrix");
+		glm::mat4 transform(1.0f);
+		if (matrix.size() == 16) {
+			// column major, like glm
+			for (int i = 0; i < 16; ++i) {
+				transform[i / 4][i % 4] = static_cast<float>(matrix[i].number);
+			}
+			return transform;
+		}
+		const std::vector<JsonValue>& translation = node.getArray("translation");
+		const std::vector<JsonValue>& rotation = node.getArray("rotation");
+		const std::vector<JsonValue>& scale = node.getArray("scale");
+		if (translation.size() == 3) {
+			transform = glm::translate(transform, glm::vec3(translation[0].number, translation[1].number, translation[2].number));
+		}
+		if (rotation.size() == 4) {
+			// glTF stores x, y, z, w; glm::quat takes w first
+			glm::quat quaternion(static_cast<float>(rotation[3].number), static_cast<float>(rotation[0].number),
+				static_cast<float>(rotation[1].number), static_cast<float>(rotation[2].number));
+			transform *= glm::mat4_cast(quaternion);
+		}
+		if (scale.size() == 3) {
+			transform = glm::scale(transform, glm::vec3(scale[0].number, scale[1].number, scale[2].number));
+		}
+		return transform;
+	}
+
+	bool addMesh(GltfDocument& doc, double meshIndex, const glm::mat4& transform, MeshData& mesh) {
+		const std::vector<JsonValue>& meshes = doc.json.getArray("meshes");
+		if (meshIndex < 0.0 || meshIndex >= static_cast<double>(meshes.size())) {
+			return false;
+		}
+		for (const JsonValue& primitive : meshes[static_cast<size_t>(meshIndex)].getArray("primitives")) {
+			if (!addPrimitive(doc, primitive, transform, mesh)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool addNode(GltfDocument& doc, double nodeIndex, const glm::mat4& parent, int depth, MeshData& mesh) {
+		const std::vector<JsonValue>& nodes = doc.json.getArray("nodes");
+		if (depth > MAX_NODE_DEPTH || nodeIndex < 0.0 || nodeIndex >= static_cast<double>(nodes.size())) {
+			return false;
+		}
+		const JsonValue& node = nodes[static_cast<size_t>(nodeIndex)];
+		glm::mat4 transform = parent * nodeTransform(node);
+		if (node.find("mesh") != nullptr && !addMesh(doc, node.getNumber("mesh", -1.0), transform, mesh)) {
+			return false;
+		}
+		for (const JsonValue& child : node.getArray("children")) {
+			if (!addNode(doc, child.number, transform, depth + 1, mesh)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool importGltf(const char* filename, MeshData& mesh) {
+		MappedFile file;
+		if (!file.open(filename)) {
+			std::cerr << "importMesh(): cannot read " << filename << std::endl;
+			return false;
+		}
+		mesh.sources.push_back(filename);
+		GltfDocument doc;
+		doc.directory = directoryOf(filename);
+
+		const char* json = reinterpret_cast<const char*>(file.getData());
+		size_t jsonSize = file.getSize();
+		std::vector<unsigned char> glbBinary;
+		uint32_t header[3];
+		if (file.getSize() >= sizeof(header)) {
+			memcpy(header, file.getData(), sizeof(header));
+		}
+		if (file.getSize() >= sizeof(header) && header[0] == GLB_MAGIC) {
+			// 12 byte header, then chunks of { length, type, data } padded to 4 bytes
+			size_t size = std::min(static_cast<size_t>(header[2]), file.getSize());
+			json = nullptr;
+			for (size_t offset = sizeof(header); offset + 8 <= size;) {
+				uint32_t chunk[2];
+				memcpy(chunk, file.getData() + offset, sizeof(chunk));
+				offset += sizeof(chunk);
+				if (chunk[0] > size - offset) {
+					break;
+				}
+				if (chunk[1] == GLB_CHUNK_JSON && json == nullptr) {
+					json = reinterpret_cast<const char*>(file.getData() + offset);
+					jsonSize = chunk[0];
+				} else if (chunk[1] == GLB_CHUNK_BIN && glbBinary.empty()) {
+					glbBinary.assign(file.getData() + offset, file.getData() + offset + chunk[0]);
+				}
+				offset += (static_cast<size_t>(chunk[0]) + 3) & ~static_cast<size_t>(3);
+			}
+			if (json == nullptr) {
+				std::cerr << "importMesh(): " << filename << " has no JSON chunk" << std::endl;
+				return false;
+			}
+		}
+
+		std::string error;
+		if (!parseJson(json, jsonSize, doc.json, error)) {
+			std::cerr << "importMesh(): " << filename << ": " << error << std::endl;
+			return false;
+		}
+		if (!loadBuffers(doc, glbBinary, mesh)) {
+			std::cerr << "importMesh(): " << filename << " has a buffer that can't be loaded" << std::endl;
+			return false;
+		}
+
+		bool ok = true;
+		const std::vector<JsonValue>& scenes = doc.json.getArray("scenes");
+		if (scenes.empty()) {
+			// a file with meshes but no scene, e.g. a library: take them as they are
+			const std::vector<JsonValue>& meshes = doc.json.getArray("meshes");
+			for (size_t i = 0; i < meshes.size() && ok; ++i) {
+				ok = addMesh(doc, static_cast<double>(i), glm::mat4(1.0f), mesh);
+			}
+		} else {
+			double scene = doc.json.getNumber("scene", 0.0);
+			if (scene < 0.0 || scene >= static_cast<double>(scenes.size())) {
+				scene = 0.0;
+			}
+			for (const JsonValue& node : scenes[static_cast<size_t>(scene)].getArray("nodes")) {
+				ok = ok && addNode(doc, node.number, glm::mat4(1.0f), 0, mesh);
+			}
+		}
+		if (!ok) {
+			std::cerr << "importMesh(): " << filename << " is not a valid glTF 2.0 file" << std::endl;
+		}
+		return ok;
+	}
+
+}
+
+bool importMesh(const char* filename, MeshData& mesh) {
+	TRACE_ZONE(TRACE_CATEGORY_RESOURCE, "import mesh")
+	mesh = MeshData();
+	bool ok;
+	if (hasSuffix(filename, ".obj")) {
+		ok = importObj(filename, mesh);
+	} else if (hasSuffix(filename, ".gltf") || hasSuffix(filename, ".glb")) {
+		ok = importGltf(filename, mesh);
+	} else {
+		std::cerr << "importMesh(): " << filename << " is neither glTF nor OBJ" << std::endl;
+		return false;
+	}
+	if (ok && mesh.indices.empty()) {
+		std::cerr << "importMesh(): " << filename << " has no triangles" << std::endl;
+		ok = false;
+	}
+	return ok;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "vertex.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Triangles of a model in the renderer's vertex layout, ready to upload or cache.
+struct MeshData {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	// every file the import read, the model itself first; MeshCache uses them to tell when it is stale
+	std::vector<std::string> sources;
+};
+
+// glTF 2.0 (.gltf with external or embedded buffers, .glb) and Wavefront .obj.
+// glTF nodes of the default scene are flattened with their transforms; only triangle lists are
+// taken. Texture coordinates are turned top-left like Vulkan's and triangles are wound clockwise,
+// which is what Mesh culls against. Vertices without a color are white.
+bool importMesh(const char* filename, MeshData& mesh);
@@ -0,0 +1,278 @@
+#include "meshoptimize.h"
+#include "log.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+	const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+	// the triangles using each vertex: those of vertex v are triangles[offsets[v]..offsets[v + 1])
+	struct Adjacency {
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+	};
+
+	void buildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount, Adjacency& adjacency) {
+		adjacency.offsets.assign(vertexCount + 1, 0);
+		for (uint32_t index : indices) {
+			++adjacency.offsets[index + 1];
+		}
+		for (size_t v = 0; v < vertexCount; ++v) {
+			adjacency.offsets[v + 1] += adjacency.offsets[v];
+		}
+		std::vector<uint32_t> next(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		adjacency.triangles.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i) {
+			adjacency.triangles[next[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	// Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007).
+	// Emits every remaining triangle around one vertex, then moves on to the neighbour that will
+	// still be cached after its own fan. triangleOrder receives the triangles in draw order and
+	// clusterStarts the position of every run that had to start over at a dead end
+	void tipsify(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize,
+		std::vector<uint32_t>& triangleOrder, std::vector<uint32_t>& clusterStarts) {
+		Adjacency adjacency;
+		buildAdjacency(indices, vertexCount, adjacency);
+		size_t triangleCount = indices.size() / 3;
+
+		std::vector<uint32_t> liveTriangles(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v) {
+			liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+		}
+		// when each vertex last entered the simulated cache
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> deadEnd;
+		std::vector<uint32_t> candidates;
+		uint32_t time = cacheSize + 1;
+		// where to look for a vertex with triangles left once the dead-end stack is used up
+		uint32_t scan = 0;
+
+		triangleOrder.clear();
+		triangleOrder.reserve(triangleCount);
+		clusterStarts.assign(1, 0);
+		uint32_t fanning = vertexCount > 0 ? 0 : NONE;
+		while (fanning != NONE) {
+			candidates.clear();
+			for (uint32_t i = adjacency.offsets[fanning]; i < adjacency.offsets[fanning + 1]; ++i) {
+				uint32_t triangle = adjacency.triangles[i];
+				if (emitted[triangle]) {
+					continue;
+				}
+				emitted[triangle] = true;
+				triangleOrder.push_back(triangle);
+				for (uint32_t corner = 0; corner < 3; ++corner) {
+					uint32_t v = indices[triangle * 3 + corner];
+					deadEnd.push_back(v);
+					candidates.push_back(v);
+					--liveTriangles[v];
+					if (time - cacheTime[v] > cacheSize) {
+						cacheTime[v] = time++;
+					}
+				}
+			}
+
+			// the oldest candidate that stays cached through its own fan; one that wouldn't scores 0
+			uint32_t next = NONE;
+			int64_t bestPriority = -1;
+			for (uint32_t v : candidates) {
+				if (liveTriangles[v] == 0) {
+					continue;
+				}
+				int64_t priority = 0;
+				if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+					priority = time - cacheTime[v];
+				}
+				if (priority > bestPriority) {
+					bestPriority = priority;
+					next = v;
+				}
+			}
+			if (next == NONE) {
+				// dead end: the most recently used vertex with triangles left, else the next in index order
+				while (next == NONE && !deadEnd.empty()) {
+					uint32_t v = deadEnd.back();
+					deadEnd.pop_back();
+					if (liveTriangles[v] > 0) {
+						next = v;
+					}
+				}
+				while (next == NONE && scan < vertexCount) {
+					if (liveTriangles[scan] > 0) {
+						next = scan;
+					}
+					++scan;
+				}
+				uint32_t position = static_cast<uint32_t>(triangleOrder.size());
+				if (next != NONE && position != clusterStarts.back()) {
+					clusterStarts.push_back(position);
+				}
+			}
+			fanning = next;
+		}
+	}
+
+	// Sorts the clusters so that those facing away from the mesh's center come first: on a closed
+	// convex-ish model they are the ones in front, whatever the view. Triangles are wound
+	// clockwise, so (p2 - p0) x (p1 - p0) points out of the front face
+	void sortClustersForOverdraw(const MeshData& mesh, std::vector<uint32_t>& triangleOrder,
+		const std::vector<uint32_t>& clusterStarts) {
+		size_t clusterCount = clusterStarts.size();
+		std::vector<glm::vec3> clusterCenters(clusterCount, glm::vec3(0.0f));
+		std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+		glm::vec3 meshCenter(0.0f);
+		float meshArea = 0.0f;
+		for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+			size_t end = cluster + 1 < clusterCount ? clusterStarts[cluster + 1] : triangleOrder.size();
+			float clusterArea = 0.0f;
+			for (size_t i = clusterStarts[cluster]; i < end; ++i) {
+				const uint32_t* triangle = &mesh.indices[triangleOrder[i] * 3];
+				const glm::vec3& p0 = mesh.vertices[triangle[0]].pos;
+				const glm::vec3& p1 = mesh.vertices[triangle[1]].pos;
+				const glm::vec3& p2 = mesh.vertices[triangle[2]].pos;
+				glm::vec3 normal = glm::cross(p2 - p0, p1 - p0);
+				float area = glm::length(normal);
+				glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+				clusterNormals[cluster] += normal;
+				clusterCenters[cluster] += center * area;
+				clusterArea += area;
+				meshCenter += center * area;
+			}
+			clusterCenters[cluster] = clusterArea > 0.0f ? clusterCenters[cluster] / clusterArea : glm::vec3(0.0f);
+			meshArea += clusterArea;
+		}
+		if (meshArea > 0.0f) {
+			meshCenter /= meshArea;
+		}
+
+		std::vector<float> facing(clusterCount);
+		for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+			float length = glm::length(clusterNormals[cluster]);
+			facing[cluster] = length > 0.0f
+				? glm::dot(clusterCenters[cluster] - meshCenter, clusterNormals[cluster] / length) : 0.0f;
+		}
+		std::vector<uint32_t> clusters(clusterCount);
+		for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+			clusters[cluster] = static_cast<uint32_t>(cluster);
+		}
+		std::stable_sort(clusters.begin(), clusters.end(), [&facing](uint32_t a, uint32_t b) {
+			return facing[a] > facing[b];
+		});
+
+		std::vector<uint32_t> sorted;
+		sorted.reserve(triangleOrder.size());
+		for (uint32_t cluster : clusters) {
+			size_t end = cluster + 1 < clusterCount ? clusterStarts[cluster + 1] : triangleOrder.size();
+			sorted.insert(sorted.end(), triangleOrder.begin() + clusterStarts[cluster], triangleOrder.begin() + end);
+		}
+		triangleOrder.swap(sorted);
+	}
+
+}
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+	uint32_t cacheSize) {
+	// the miss count at which each vertex entered the FIFO, 0 when it never did
+	std::vector<size_t> cachedAt(vertexCount, 0);
+	size_t misses = 0;
+	size_t usedVertices = 0;
+	for (size_t i = 0; i < indexCount; ++i) {
+		size_t& entered = cachedAt[indices[i]];
+		if (entered == 0) {
+			++usedVertices;
+		}
+		if (entered == 0 || misses - entered >= cacheSize) {
+			entered = ++misses;
+		}
+	}
+	VertexCacheStats stats;
+	if (indexCount >= 3) {
+		stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+		stats.atvr = static_cast<float>(misses) / static_cast<float>(usedVertices);
+	}
+	return stats;
+}
+
+MeshOptimizeReport optimizeMesh(MeshData& mesh, const MeshOptimizeSettings& settings) {
+	TRACE_ZONE(TRACE_CATEGORY_RESOURCE, "optimize mesh")
+	MeshOptimizeReport report;
+	size_t vertexCount = mesh.vertices.size();
+	report.before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount, settings.cacheSize);
+	if (mesh.indices.size() < 3) {
+		report.after = report.before;
+		return report;
+	}
+
+	std::vector<uint32_t> triangleOrder;
+	std::vector<uint32_t> clusterStarts;
+	tipsify(mesh.indices, vertexCount, settings.cacheSize, triangleOrder, clusterStarts);
+	if (settings.reduceOverdraw) {
+		sortClustersForOverdraw(mesh, triangleOrder, clusterStarts);
+	}
+	report.clusterCount = clusterStarts.size();
+
+	// vertices are renumbered in the order the reordered triangles first reach them
+	std::vector<uint32_t> remap(vertexCount, NONE);
+	std::vector<Vertex> vertices;
+	vertices.reserve(vertexCount);
+	std::vector<uint32_t> indices(triangleOrder.size() * 3);
+	for (size_t i = 0; i < triangleOrder.size(); ++i) {
+		for (uint32_t corner = 0; corner < 3; ++corner) {
+			uint32_t index = mesh.indices[triangleOrder[i] * 3 + corner];
+			if (remap[index] == NONE) {
+				remap[index] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(mesh.vertices[index]);
+			}
+			indices[i * 3 + corner] = remap[index];
+		}
+	}
+	mesh.vertices.swap(vertices);
+	mesh.indices.swap(indices);
+
+	report.after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), settings.cacheSize);
+	return report;
+}
+
+void splitMesh(const uint32_t* indices, size_t indexCount, uint32_t maxVertices, std::vector<Submesh>& submeshes,
+	std::vector<uint32_t>& vertexSources, std::vector<uint32_t>& localIndices) {
+	submeshes.clear();
+	vertexSources.clear();
+	localIndices.resize(indexCount);
+	if (indexCount == 0) {
+		return;
+	}
+	uint32_t vertexCount = *std::max_element(indices, indices + indexCount) + 1;
+	// the local index of each vertex in the current run; valid only where runOf matches
+	std::vector<uint32_t> localIndex(vertexCount);
+	std::vector<uint32_t> runOf(vertexCount, NONE);
+	Submesh submesh { .firstIndex = 0, .indexCount = 0, .vertexOffset = 0 };
+	for (size_t i = 0; i + 2 < indexCount; i += 3) {
+		uint32_t run = static_cast<uint32_t>(submeshes.size());
+		uint32_t newVertices = 0;
+		for (size_t corner = 0; corner < 3; ++corner) {
+			// a degenerate triangle may name a new vertex twice; counting it twice only cuts early
+			newVertices += runOf[indices[i + corner]] != run ? 1 : 0;
+		}
+		uint32_t runVertices = static_cast<uint32_t>(vertexSources.size()) - submesh.vertexOffset;
+		if (submesh.indexCount > 0 && runVertices + newVertices > maxVertices) {
+			submeshes.push_back(submesh);
+			submesh = { .firstIndex = static_cast<uint32_t>(i), .indexCount = 0,
+				.vertexOffset = static_cast<uint32_t>(vertexSources.size()) };
+			run = static_cast<uint32_t>(submeshes.size());
+		}
+		for (size_t corner = 0; corner < 3; ++corner) {
+			uint32_t index = indices[i + corner];
+			if (runOf[index] != run) {
+				runOf[index] = run;
+				localIndex[index] = static_cast<uint32_t>(vertexSources.size()) - submesh.vertexOffset;
+				vertexSources.push_back(index);
+			}
+			localIndices[i + corner] = localIndex[index];
+		}
+		submesh.indexCount += 3;
+	}
+	submeshes.push_back(submesh);
+}
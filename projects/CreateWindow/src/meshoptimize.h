@@ -0,0 +1,51 @@
+#pragma once
+
+#include "meshimport.h"
+#include <cstddef>
+#include <cstdint>
+
+// Post-transform vertex cache behaviour of an index buffer, simulated as a FIFO of cacheSize
+// vertices, which is roughly how GPUs reuse vertex shader results.
+struct VertexCacheStats {
+	// vertex shader invocations per triangle: 3 without any reuse, about 0.5 at best
+	float acmr = 0.0f;
+	// invocations per vertex the indices use: 1 is ideal
+	float atvr = 0.0f;
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+	uint32_t cacheSize);
+
+struct MeshOptimizeSettings {
+	// the cache Tipsify plans for; a smaller one than the hardware has is safe, a larger one thrashes
+	uint32_t cacheSize = 16;
+	// draw the outward facing clusters of triangles first, so more of the rest fails the depth test
+	bool reduceOverdraw = true;
+};
+
+struct MeshOptimizeReport {
+	VertexCacheStats before;
+	VertexCacheStats after;
+	size_t clusterCount = 0;
+};
+
+// Reorders the triangles of mesh for the post-transform vertex cache (Tipsify), optionally the
+// clusters that produces for overdraw, and then the vertices in the order the indices first use
+// them, for fetch locality. The same triangles are drawn with the same winding; vertices no
+// triangle uses are dropped.
+MeshOptimizeReport optimizeMesh(MeshData& mesh, const MeshOptimizeSettings& settings = MeshOptimizeSettings());
+
+// a draw of part of an index buffer, whose indices are relative to vertexOffset
+struct Submesh {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t vertexOffset;
+};
+
+// Cuts the triangles, in order, into runs that use at most maxVertices distinct vertices each, so
+// their indices fit a narrower type. Every run gets its own copy of the vertices it uses, starting
+// at its vertexOffset: output vertex i copies vertexSources[i], and localIndices are relative to
+// their run's vertexOffset. Vertices shared across a cut are copied into both runs; the vertex
+// order optimizeMesh() leaves keeps those few.
+void splitMesh(const uint32_t* indices, size_t indexCount, uint32_t maxVertices, std::vector<Submesh>& submeshes,
+	std::vector<uint32_t>& vertexSources, std::vector<uint32_t>& localIndices);
@@ -0,0 +1,83 @@
+#include "pipelinecache.h"
+#include "log.h"
+#include <cassert>
+#include <cstring>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+void PipelineCache::initialize(const DeviceInfo& deviceInfo, VkDevice device_, const std::string& path_) {
+	FUNCNAME()
+	device = device_;
+	path = path_;
+	deviceProperties = deviceInfo.getProperties();
+
+	std::vector<char> data;
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (file.is_open()) {
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(data.data(), data.size());
+	}
+	warm = isCompatible(data);
+	if (!warm && !data.empty()) {
+		std::cerr << "PipelineCache: " << path << " was written by another device or driver, ignoring it" << std::endl;
+	}
+
+	VkPipelineCacheCreateInfo createInfo {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = warm ? data.size() : 0,
+		.pInitialData = warm ? data.data() : nullptr
+	};
+	if (vkCreatePipelineCache(device, &createInfo, nullptr, &cache) != VK_SUCCESS) {
+		assert(0);
+	}
+}
+
+bool PipelineCache::isCompatible(const std::vector<char>& data) const {
+	VkPipelineCacheHeaderVersionOne header;
+	if (data.size() < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data.data(), sizeof(header));
+	return header.headerSize >= sizeof(header)
+		&& header.headerSize <= data.size()
+		&& header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& header.vendorID == deviceProperties.vendorID
+		&& header.deviceID == deviceProperties.deviceID
+		&& memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::save() {
+	FUNCNAME()
+	size_t size = 0;
+	if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS) {
+		return;
+	}
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS) {
+		return;
+	}
+
+	// write next to the old file and swap, so a crash never leaves a truncated cache behind
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			std::cerr << "PipelineCache: cannot write " << tempPath << std::endl;
+			return;
+		}
+		file.write(data.data(), size);
+	}
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error) {
+		std::cerr << "PipelineCache: cannot replace " << path << ": " << error.message() << std::endl;
+	}
+}
+
+void PipelineCache::destroy() {
+	vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "deviceinfo.h"
+#include <string>
+#include <vector>
+
+// A VkPipelineCache that survives across runs.
+// The file is only handed to the driver when its header matches the current device
+// (vendorID, deviceID, pipelineCacheUUID); anything else starts from an empty cache.
+class PipelineCache {
+public:
+	void initialize(const DeviceInfo& deviceInfo, VkDevice device, const std::string& path);
+	// writes the cache contents back to the file it was loaded from
+	void save();
+	void destroy();
+
+	inline VkPipelineCache getCache() const { return cache; }
+	// true when the cache was seeded from a valid file
+	inline bool isWarm() const { return warm; }
+
+private:
+	bool isCompatible(const std::vector<char>& data) const;
+
+	VkDevice device;
+	VkPhysicalDeviceProperties deviceProperties;
+	std::string path;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	bool warm = false;
+};
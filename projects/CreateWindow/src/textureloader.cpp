@@ -0,0 +1,614 @@
+#include "textureloader.h"
+#include "cookedtexture.h"
+#include "imagefilter.h"
+#include "utils.h"
+#include "log.h"
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+void TextureLoader::initialize(const DeviceInfo& deviceInfo_, VkDevice device_, DeviceAllocator& allocator_,
+	ThreadPool& threadPool_, VkCommandPool commandPool_, VkQueue queue_,
+	uint32_t framesInFlight_, VkDeviceSize budget_)
+{
+	FUNCNAME()
+	deviceInfo = &deviceInfo_;
+	device = device_;
+	allocator = &allocator_;
+	threadPool = &threadPool_;
+	commandPool = commandPool_;
+	queue = queue_;
+	framesInFlight = framesInFlight_;
+	budget = budget_;
+	linearBlit = supportsLinearBlit(*deviceInfo, VK_FORMAT_B8G8R8A8_UNORM);
+
+	// mid grey, so a missing texture is visible but not glaring
+	Decoded placeholder;
+	placeholder.format = VK_FORMAT_B8G8R8A8_UNORM;
+	placeholder.width = 2;
+	placeholder.height = 2;
+	placeholder.data.assign(2 * 2 * 4, 128);
+	placeholder.base = placeholder.data.data();
+	placeholder.levels.push_back({ 0, placeholder.data.size(), 2, 2 });
+
+	textures.emplace_back();
+	UploadBatch upload;
+	upload.begin(device, *allocator, commandPool, queue);
+	if (!record(upload, placeholder, textures[PLACEHOLDER])) {
+		assert(0);
+	}
+	upload.submit();
+	upload.wait();
+	textures[PLACEHOLDER].resident = true;
+	// every texture lives in the same device local heap as the placeholder
+	heapIndex = allocator->getHeapIndex(textures[PLACEHOLDER].allocation.memoryType);
+}
+
+void TextureLoader::destroy() {
+	FUNCNAME()
+	batch.wait();
+	ready.clear();
+	destroyRetired(true);
+	for (Texture& texture : textures) {
+		if (texture.view != VK_NULL_HANDLE) {
+			vkDestroyImageView(device, texture.view, nullptr);
+			destroyImage(device, *allocator, texture.image, texture.allocation);
+		}
+	}
+	textures.clear();
+}
+
+void TextureLoader::enableHostImageCopy(const HostImageCopy& hostImageCopy_) {
+	if (!hostImageCopy_.isEnabled()) {
+		return;
+	}
+	hostImageCopy = &hostImageCopy_;
+	hostCopyMipmaps = hostImageCopy->supportsFormat(VK_FORMAT_B8G8R8A8_UNORM);
+	LOG("TextureLoader: host image copy" << (hostCopyMipmaps ? "" : " for some formats"))
+}
+
+TextureHandle TextureLoader::request(const std::string& path) {
+	TextureHandle handle = static_cast<TextureHandle>(textures.size());
+	textures.emplace_back();
+	textures[handle].path = path;
+	textures[handle].lastUsed = frameNumber;
+	requestDecode(handle);
+	return handle;
+}
+
+void TextureLoader::requestDecode(TextureHandle handle) {
+	textures[handle].loading = true;
+	{
+		std::lock_guard<std::mutex> lock(readyMutex);
+		++decoding;
+	}
+	Decoded* decoded = new Decoded;
+	decoded->path = textures[handle].path;
+	decoded->handle = handle;
+	threadPool->submit([this, decoded] {
+		decode(*decoded);
+		{
+			std::lock_guard<std::mutex> lock(readyMutex);
+			ready.emplace_back(decoded);
+			--decoding;
+		}
+		readyCondition.notify_all();
+	});
+}
+
+void TextureLoader::update() {
+	++frameNumber;
+	destroyRetired(false);
+	if (batch.isPending()) {
+		if (!batch.poll()) {
+			return;
+		}
+		retireBatch();
+	}
+	VkDeviceSize currentBudget = getBudget();
+	streamBack(currentBudget);
+
+	std::vector<std::unique_ptr<Decoded>> finished;
+	{
+		std::lock_guard<std::mutex> lock(readyMutex);
+		VkDeviceSize staged = 0;
+		size_t count = 0;
+		for (; count < ready.size(); ++count) {
+			VkDeviceSize size = stagingSize(*ready[count]);
+			if (count > 0 && staged + size > UPLOAD_BUDGET_PER_FRAME) {
+				break;
+			}
+			staged += size;
+		}
+		finished.assign(std::make_move_iterator(ready.begin()), std::make_move_iterator(ready.begin() + count));
+		ready.erase(ready.begin(), ready.begin() + count);
+	}
+	VkDeviceSize incoming = 0;
+	for (const std::unique_ptr<Decoded>& decoded : finished) {
+		textures[decoded->handle].loading = false;
+		incoming += imageSize(*decoded);
+	}
+	while (usage + incoming > currentBudget && evictUnused()) {
+	}
+	std::vector<TextureHandle> dropCandidates;
+	if (usage + incoming > currentBudget) {
+		dropCandidates = findDropCandidates();
+	}
+	// whatever can be written from the CPU needs no batch
+	if (hostImageCopy != nullptr) {
+		auto uploaded = [this](const std::unique_ptr<Decoded>& decoded) {
+			return !decoded->failed && uploadFromHost(*decoded, textures[decoded->handle]);
+		};
+		finished.erase(std::remove_if(finished.begin(), finished.end(), uploaded), finished.end());
+	}
+	if (finished.empty() && dropCandidates.empty()) {
+		return;
+	}
+
+	TRACE_ZONE(TRACE_CATEGORY_RESOURCE, "texture uploads")
+	batch.begin(device, *allocator, commandPool, queue);
+	// everything left is being drawn: halve the least recently used ones, one level per frame each
+	for (TextureHandle handle : dropCandidates) {
+		if (usage + incoming <= currentBudget || !dropLevel(batch, textures[handle])) {
+			break;
+		}
+	}
+	for (std::unique_ptr<Decoded>& decoded : finished) {
+		Texture& texture = textures[decoded->handle];
+		if (decoded->failed) {
+			std::cerr << "TextureLoader: " << decoded->path << " stays on the placeholder" << std::endl;
+			texture.failed = true;
+			continue;
+		}
+		// the budget is only an estimate of what the device has left
+		bool recorded = record(batch, *decoded, texture);
+		while (!recorded && evictUnused()) {
+			recorded = record(batch, *decoded, texture);
+		}
+		if (!recorded) {
+			std::cerr << "TextureLoader: out of device memory for " << decoded->path << std::endl;
+			texture.retryFrame = frameNumber + OUT_OF_MEMORY_RETRY_FRAMES;
+			continue;
+		}
+		batchTextures.push_back(decoded->handle);
+	}
+	// staging now holds the texels, so the decoded copies can go before the GPU is done
+	finished.clear();
+	batch.submit();
+}
+
+void TextureLoader::flush() {
+	FUNCNAME()
+	for (;;) {
+		update();
+		if (batch.isPending()) {
+			batch.wait();
+			retireBatch();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(readyMutex);
+		if (ready.empty() && decoding == 0) {
+			return;
+		}
+		readyCondition.wait(lock, [this] { return !ready.empty() || decoding == 0; });
+	}
+}
+
+void TextureLoader::retireBatch() {
+	for (TextureHandle handle : batchTextures) {
+		// only a texture that kept its image since it was recorded has anything to show
+		if (textures[handle].view != VK_NULL_HANDLE) {
+			textures[handle].resident = true;
+		}
+	}
+	batchTextures.clear();
+}
+
+void TextureLoader::decode(Decoded& decoded) const {
+	TRACE_ZONE(TRACE_CATEGORY_RESOURCE, "decode texture")
+	const char* path = decoded.path.c_str();
+	if (isCookedTextureFile(path)) {
+		decoded.mappedFile = std::make_unique<MappedFile>();
+		CookedTexture cooked;
+		if (!decoded.mappedFile->open(path)
+			|| !parseCookedTexture(decoded.mappedFile->getData(), decoded.mappedFile->getSize(), cooked)) {
+			std::cerr << "Error loading: " << path << std::endl;
+			decoded.failed = true;
+			return;
+		}
+		decoded.format = cooked.format;
+		decoded.width = cooked.width;
+		decoded.height = cooked.height;
+		decoded.levels = std::move(cooked.levels);
+		decoded.base = decoded.mappedFile->getData();
+	} else if (isCompressedImageFile(path)) {
+		CompressedImage image;
+		if (!loadCompressedImage(path, image)) {
+			decoded.failed = true;
+			return;
+		}
+		decoded.format = image.format;
+		decoded.width = image.width;
+		decoded.height = image.height;
+		decoded.levels = std::move(image.levels);
+		decoded.data = std::move(image.data);
+		decoded.base = decoded.data.data();
+	} else {
+		decoded.image = freeimage::loadImage(path);
+		if (!decoded.image.isValid()) {
+			decoded.failed = true;
+			return;
+		}
+		decoded.format = VK_FORMAT_B8G8R8A8_UNORM;
+		decoded.width = static_cast<uint32_t>(decoded.image.width);
+		decoded.height = static_cast<uint32_t>(decoded.image.height);
+		decoded.mipLevels = mipLevelCount(decoded.width, decoded.height);
+		if (linearBlit && !hostCopyMipmaps) {
+			decoded.generateMipmaps = true;
+			return;
+		}
+		// without linear blit support, or for a host copy, every level is box filtered here, off the render thread
+		size_t totalSize = 0;
+		for (uint32_t level = 0; level < decoded.mipLevels; ++level) {
+			uint32_t levelWidth = std::max(decoded.width >> level, 1u);
+			uint32_t levelHeight = std::max(decoded.height >> level, 1u);
+			size_t levelSize = static_cast<size_t>(levelWidth) * levelHeight * 4;
+			decoded.levels.push_back({ totalSize, levelSize, levelWidth, levelHeight });
+			totalSize += levelSize;
+		}
+		decoded.data.resize(totalSize);
+		decoded.image.copyTo(decoded.data.data(), static_cast<size_t>(decoded.width) * 4);
+		decoded.image.unload();
+		for (uint32_t level = 1; level < decoded.mipLevels; ++level) {
+			const CompressedImage::Level& parent = decoded.levels[level - 1];
+			downsampleBox(decoded.data.data() + parent.offset, parent.width, parent.height,
+				decoded.data.data() + decoded.levels[level].offset);
+		}
+		decoded.base = decoded.data.data();
+		return;
+	}
+	decoded.mipLevels = static_cast<uint32_t>(decoded.levels.size());
+	if (compressedBlockSize(decoded.format) != 0 && !supportsSampledImage(*deviceInfo, decoded.format)) {
+		decodeBlocks(decoded);
+	}
+}
+
+void TextureLoader::decodeBlocks(Decoded& decoded) const {
+	// only a device without BC support pays for this
+	VkFormat format = decompressedFormat(decoded.format);
+	if (format == VK_FORMAT_UNDEFINED) {
+		std::cerr << "TextureLoader: " << decoded.path << " uses a block format this device can't sample" << std::endl;
+		decoded.failed = true;
+		return;
+	}
+	std::vector<CompressedImage::Level> levels;
+	size_t totalSize = 0;
+	for (const CompressedImage::Level& level : decoded.levels) {
+		size_t levelSize = static_cast<size_t>(level.width) * level.height * 4;
+		levels.push_back({ totalSize, levelSize, level.width, level.height });
+		totalSize += levelSize;
+	}
+	std::vector<unsigned char> data(totalSize);
+	for (size_t i = 0; i < levels.size(); ++i) {
+		decompressLevel(decoded.format, decoded.base + decoded.levels[i].offset,
+			levels[i].width, levels[i].height, data.data() + levels[i].offset);
+	}
+	decoded.format = format;
+	decoded.levels = std::move(levels);
+	decoded.data = std::move(data);
+	decoded.base = decoded.data.data();
+	decoded.mappedFile.reset();
+}
+
+VkDeviceSize TextureLoader::stagingSize(const Decoded& decoded) {
+	if (decoded.failed) {
+		return 0;
+	}
+	if (decoded.generateMipmaps) {
+		return alignUp(static_cast<VkDeviceSize>(decoded.width) * 4, 64) * decoded.height;
+	}
+	const CompressedImage::Level& first = decoded.levels.front();
+	const CompressedImage::Level& last = decoded.levels.back();
+	return last.offset + last.size - first.offset;
+}
+
+bool TextureLoader::record(UploadBatch& upload, Decoded& decoded, Texture& texture) {
+	// TRANSFER_SRC for the mip blits and for copying levels out when some are dropped
+	VkImage image;
+	Allocation allocation;
+	if (!tryCreateImage(device, *allocator, decoded.width, decoded.height, decoded.mipLevels,
+		decoded.format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		MemoryClass::DeviceLocal,
+		image, allocation)) {
+		return false;
+	}
+
+	// one transition for the whole chain
+	upload.transitionImageLayout(image, decoded.format,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		decoded.mipLevels);
+
+	VkDeviceSize size = stagingSize(decoded);
+	UploadBatch::Staging staging = upload.stage(size, COOKED_TEXTURE_ALIGNMENT);
+	if (decoded.generateMipmaps) {
+		// the decoder converts level 0 straight into mapped staging; rows start on a cache line,
+		// so bufferRowLength carries the padded pitch whenever width * 4 isn't a multiple of 64
+		VkDeviceSize rowPitch = size / decoded.height;
+		decoded.image.copyTo(static_cast<unsigned char*>(staging.data), static_cast<size_t>(rowPitch));
+		decoded.image.unload();
+		VkBufferImageCopy region {
+			.bufferOffset = staging.offset,
+			.bufferRowLength = static_cast<uint32_t>(rowPitch / 4),
+			.bufferImageHeight = 0,
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = 0,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.imageOffset = { 0, 0, 0 },
+			.imageExtent = { decoded.width, decoded.height, 1 }
+		};
+		upload.copyBufferToImage(staging.buffer, image, 1, &region);
+		cmdGenerateMipmaps(upload.getCommandBuffer(), image, decoded.width, decoded.height, decoded.mipLevels);
+	} else {
+		// levels are laid out in order, so the whole chain is one copy, padding included;
+		// rows of compressed levels are counted in texels, so bufferRowLength stays 0 (tightly packed)
+		const CompressedImage::Level& first = decoded.levels.front();
+		memcpy(staging.data, decoded.base + first.offset, static_cast<size_t>(size));
+		std::vector<VkBufferImageCopy> regions(decoded.mipLevels);
+		for (uint32_t i = 0; i < decoded.mipLevels; ++i) {
+			const CompressedImage::Level& level = decoded.levels[i];
+			regions[i] = {
+				.bufferOffset = staging.offset + (level.offset - first.offset),
+				.bufferRowLength = 0,
+				.bufferImageHeight = 0,
+				.imageSubresource = {
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.mipLevel = i,
+					.baseArrayLayer = 0,
+					.layerCount = 1
+				},
+				.imageOffset = { 0, 0, 0 },
+				.imageExtent = { level.width, level.height, 1 }
+			};
+		}
+		upload.copyBufferToImage(staging.buffer, image, decoded.mipLevels, regions.data());
+		upload.transitionImageLayout(image, decoded.format,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			decoded.mipLevels);
+	}
+	// a reload replaces the image with fewer levels; the barriers above order the upload before any
+	// later draw, so the new view can be handed out right away and the old one retired
+	adopt(texture, image, allocation, decoded);
+	return true;
+}
+
+bool TextureLoader::uploadFromHost(const Decoded& decoded, Texture& texture) {
+	if (decoded.generateMipmaps || !hostImageCopy->supportsFormat(decoded.format)) {
+		return false;
+	}
+	VkImage image;
+	Allocation allocation;
+	if (!tryCreateImage(device, *allocator, decoded.width, decoded.height, decoded.mipLevels,
+		decoded.format,
+		VK_IMAGE_TILING_OPTIMAL,
+		HostImageCopy::getUsage(),
+		MemoryClass::DeviceLocal,
+		image, allocation)) {
+		return false;
+	}
+	std::vector<const void*> levels(decoded.mipLevels);
+	std::vector<VkExtent2D> extents(decoded.mipLevels);
+	for (uint32_t i = 0; i < decoded.mipLevels; ++i) {
+		levels[i] = decoded.base + decoded.levels[i].offset;
+		extents[i] = { decoded.levels[i].width, decoded.levels[i].height };
+	}
+	if (!hostImageCopy->upload(image, decoded.mipLevels, levels.data(), extents.data())) {
+		destroyImage(device, *allocator, image, allocation);
+		return false;
+	}
+	// the GPU has never seen the image, so there is nothing to wait for
+	adopt(texture, image, allocation, decoded);
+	texture.resident = true;
+	return true;
+}
+
+void TextureLoader::adopt(Texture& texture, VkImage image, const Allocation& allocation, const Decoded& decoded) {
+	if (texture.image != VK_NULL_HANDLE) {
+		retire(texture);
+	}
+	texture.image = image;
+	texture.allocation = allocation;
+	texture.view = createImageView(device, image, decoded.format,
+		VK_IMAGE_ASPECT_COLOR_BIT, decoded.mipLevels);
+	texture.format = decoded.format;
+	texture.width = decoded.width;
+	texture.height = decoded.height;
+	texture.mipLevels = decoded.mipLevels;
+	texture.droppedLevels = 0;
+	texture.fullSize = allocation.size;
+	usage += allocation.size;
+}
+
+VkDeviceSize TextureLoader::imageSize(const Decoded& decoded) {
+	if (decoded.failed) {
+		return 0;
+	}
+	// the full chain is a third larger than level 0
+	if (decoded.generateMipmaps) {
+		return static_cast<VkDeviceSize>(decoded.width) * decoded.height * 4 * 4 / 3;
+	}
+	return stagingSize(decoded);
+}
+
+VkDeviceSize TextureLoader::getBudget() const {
+	if (budget != 0) {
+		return budget;
+	}
+	// the textures may grow into whatever the rest of the process leaves of the heap
+	DeviceAllocator::HeapBudget heap = allocator->getHeapBudget(heapIndex);
+	VkDeviceSize others = heap.usage > usage ? heap.usage - usage : 0;
+	return heap.budget > others ? heap.budget - others : 0;
+}
+
+std::vector<TextureHandle> TextureLoader::findDropCandidates() const {
+	std::vector<TextureHandle> candidates;
+	for (TextureHandle handle = PLACEHOLDER + 1; handle < textures.size(); ++handle) {
+		const Texture& texture = textures[handle];
+		if (texture.resident && texture.mipLevels > 1
+			&& std::max(texture.width, texture.height) / 2 >= MIN_DROP_SIZE) {
+			candidates.push_back(handle);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [this](TextureHandle a, TextureHandle b) {
+		return textures[a].lastUsed < textures[b].lastUsed;
+	});
+	return candidates;
+}
+
+bool TextureLoader::evictUnused() {
+	Texture* victim = nullptr;
+	for (size_t i = PLACEHOLDER + 1; i < textures.size(); ++i) {
+		Texture& texture = textures[i];
+		// update() runs after the fence of frame frameNumber - framesInFlight, so anything last
+		// drawn in that frame or earlier is no longer read by the GPU
+		if (texture.image == VK_NULL_HANDLE || texture.lastUsed + framesInFlight > frameNumber) {
+			continue;
+		}
+		// a texture recorded into the open batch is still the target of its pending copy
+		if (!texture.resident || std::find(batchTextures.begin(), batchTextures.end(), i) != batchTextures.end()) {
+			continue;
+		}
+		if (victim == nullptr || texture.lastUsed < victim->lastUsed) {
+			victim = &texture;
+		}
+	}
+	if (victim == nullptr) {
+		return false;
+	}
+	evict(*victim);
+	return true;
+}
+
+void TextureLoader::evict(Texture& texture) {
+	LOG("TextureLoader: evicting " << texture.path)
+	retire(texture);
+	texture.resident = false;
+	texture.droppedLevels = 0;
+}
+
+bool TextureLoader::dropLevel(UploadBatch& upload, Texture& texture) {
+	uint32_t width = std::max(texture.width / 2, 1u);
+	uint32_t height = std::max(texture.height / 2, 1u);
+	uint32_t mipLevels = texture.mipLevels - 1;
+	VkImage image;
+	Allocation allocation;
+	if (!tryCreateImage(device, *allocator, width, height, mipLevels,
+		texture.format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		MemoryClass::DeviceLocal,
+		image, allocation)) {
+		return false;
+	}
+	LOG("TextureLoader: dropping a level of " << texture.path)
+
+	// level i + 1 of the old image becomes level i of the new one, on the GPU
+	upload.transitionImageLayout(texture.image, texture.format,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		texture.mipLevels);
+	upload.transitionImageLayout(image, texture.format,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		mipLevels);
+	std::vector<VkImageCopy> regions(mipLevels);
+	for (uint32_t i = 0; i < mipLevels; ++i) {
+		regions[i] = {
+			.srcSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = i + 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.srcOffset = { 0, 0, 0 },
+			.dstSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = i,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.dstOffset = { 0, 0, 0 },
+			.extent = { std::max(width >> i, 1u), std::max(height >> i, 1u), 1 }
+		};
+	}
+	vkCmdCopyImage(upload.getCommandBuffer(),
+		texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		mipLevels, regions.data());
+	upload.transitionImageLayout(image, texture.format,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		mipLevels);
+
+	uint32_t droppedLevels = texture.droppedLevels + 1;
+	retire(texture);
+	texture.image = image;
+	texture.allocation = allocation;
+	texture.view = createImageView(device, image, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+	texture.width = width;
+	texture.height = height;
+	texture.mipLevels = mipLevels;
+	texture.droppedLevels = droppedLevels;
+	usage += allocation.size;
+	return true;
+}
+
+void TextureLoader::streamBack(VkDeviceSize currentBudget) {
+	VkDeviceSize reserved = 0;
+	for (TextureHandle handle = PLACEHOLDER + 1; handle < textures.size(); ++handle) {
+		Texture& texture = textures[handle];
+		if (texture.loading || texture.failed || texture.lastUsed + 1 < frameNumber || frameNumber < texture.retryFrame) {
+			continue;
+		}
+		if (!texture.resident) {
+			// drawn with the placeholder right now; update() evicts something else if needed
+			LOG("TextureLoader: streaming " << texture.path << " back in")
+			requestDecode(handle);
+		} else if (texture.droppedLevels > 0) {
+			// only with room for every level, or the texture would just be halved again
+			VkDeviceSize growth = texture.fullSize - texture.allocation.size;
+			if (usage + reserved + growth <= currentBudget) {
+				reserved += growth;
+				requestDecode(handle);
+			}
+		}
+	}
+}
+
+void TextureLoader::retire(Texture& texture) {
+	retired.push_back({ texture.image, texture.allocation, texture.view, frameNumber });
+	usage -= texture.allocation.size;
+	texture.image = VK_NULL_HANDLE;
+	texture.allocation = Allocation();
+	texture.view = VK_NULL_HANDLE;
+}
+
+void TextureLoader::destroyRetired(bool all) {
+	auto done = [this, all](const Retired& image) {
+		return all || image.frame + framesInFlight <= frameNumber;
+	};
+	for (Retired& image : retired) {
+		if (done(image)) {
+			vkDestroyImageView(device, image.view, nullptr);
+			destroyImage(device, *allocator, image.image, image.allocation);
+		}
+	}
+	retired.erase(std::remove_if(retired.begin(), retired.end(), done), retired.end());
+}
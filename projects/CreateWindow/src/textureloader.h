@@ -0,0 +1,180 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "allocator.h"
+#include "upload.h"
+#include "imageloader.h"
+#include "compressedimage.h"
+#include "mappedfile.h"
+#include "threadpool.h"
+#include "hostimagecopy.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+// index into TextureLoader; 0 is the placeholder
+using TextureHandle = uint32_t;
+
+// Loads textures in the background and keeps their device memory within a budget.
+// request() queues the decode on the thread pool and returns at once; update(), called by the
+// render thread once per frame, records every decode that has finished into one upload batch.
+// Until that batch has completed, getImageView() returns a small placeholder instead.
+// With VK_EXT_host_image_copy, formats that allow it skip the batch: update() writes the texels
+// into the image from the CPU and the texture is resident at once.
+//
+// Every texture remembers the last frame it was drawn in (touch()). When the textures outgrow the
+// budget, update() first evicts the least recently used ones that no frame in flight draws, then
+// halves the ones still in use by dropping their largest mip level. Evicted textures are decoded
+// again once they are drawn, dropped levels come back once there is room for them.
+//
+//	TextureHandle texture = textureLoader.request("../../resources/hob.jpg");
+//	...
+//	textureLoader.update(); // every frame
+//	textureLoader.touch(texture); // every frame it is drawn in
+//	if (boundView != textureLoader.getImageView(texture)) { /* rewrite the descriptor */ }
+class TextureLoader {
+public:
+	// budget is in bytes; 0 follows the heap budget of DeviceAllocator
+	void initialize(const DeviceInfo& deviceInfo, VkDevice device, DeviceAllocator& allocator,
+		ThreadPool& threadPool, VkCommandPool commandPool, VkQueue queue,
+		uint32_t framesInFlight, VkDeviceSize budget = 0);
+	// the thread pool must be destroyed first, so that no decode is still running
+	void destroy();
+	// call before the first request(); hostImageCopy must outlive the loader
+	void enableHostImageCopy(const HostImageCopy& hostImageCopy);
+
+	TextureHandle request(const std::string& path);
+	// retires the previous upload batch, enforces the budget, then submits the finished decodes.
+	// call once per frame, after the frame's fence has signaled
+	void update();
+	// blocks until every requested texture is resident or has failed to load
+	void flush();
+
+	inline void touch(TextureHandle handle) { textures[handle].lastUsed = frameNumber; }
+	inline bool isResident(TextureHandle handle) const { return textures[handle].resident; }
+	// the placeholder's view until the texture is resident; changes when levels are dropped or restored
+	inline VkImageView getImageView(TextureHandle handle) const {
+		return textures[handle].resident ? textures[handle].view : textures[0].view;
+	}
+	// device memory of the resident textures
+	inline VkDeviceSize getUsage() const { return usage; }
+
+	static constexpr TextureHandle PLACEHOLDER = 0;
+
+private:
+	struct Texture {
+		VkImage image = VK_NULL_HANDLE;
+		Allocation allocation {};
+		VkImageView view = VK_NULL_HANDLE;
+		bool resident = false;
+		// a decode is queued or running
+		bool loading = false;
+		// the file could not be loaded, it is not tried again
+		bool failed = false;
+		std::string path;
+		// of the resident image, i.e. after dropped levels
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 0;
+		uint32_t droppedLevels = 0;
+		// allocation size with every level, what a reload needs
+		VkDeviceSize fullSize = 0;
+		uint64_t lastUsed = 0;
+		// no reload before this frame once the device has run out of memory for it
+		uint64_t retryFrame = 0;
+	};
+
+	// images that frames in flight may still sample, destroyed framesInFlight frames later
+	struct Retired {
+		VkImage image;
+		Allocation allocation;
+		VkImageView view;
+		uint64_t frame;
+	};
+
+	// everything a worker produces for one texture; uploaded by the render thread
+	struct Decoded {
+		~Decoded() { image.unload(); }
+		std::string path;
+		TextureHandle handle = PLACEHOLDER;
+		bool failed = false;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 1;
+		// only level 0 is uploaded; the GPU blits the rest
+		bool generateMipmaps = false;
+		// decoded but not yet converted, so copyTo() can write straight into staging
+		freeimage::ImageData image { nullptr };
+		// cooked files are copied from the mapping without a decode
+		std::unique_ptr<MappedFile> mappedFile;
+		std::vector<unsigned char> data;
+		// levels relative to base, largest first
+		const unsigned char* base = nullptr;
+		std::vector<CompressedImage::Level> levels;
+	};
+
+	// at most this much is staged per frame, so a burst of finished decodes doesn't stall a frame;
+	// a texture larger than that still goes up alone
+	static constexpr VkDeviceSize UPLOAD_BUDGET_PER_FRAME = 64ull * 1024 * 1024;
+	// levels are only dropped while the rest stays at least this large
+	static constexpr uint32_t MIN_DROP_SIZE = 64;
+	static constexpr uint64_t OUT_OF_MEMORY_RETRY_FRAMES = 120;
+
+	// worker thread
+	void decode(Decoded& decoded) const;
+	void decodeBlocks(Decoded& decoded) const;
+	// render thread
+	void requestDecode(TextureHandle handle);
+	// false when there is no device memory for the image
+	bool record(UploadBatch& upload, Decoded& decoded, Texture& texture);
+	// false when the texture has to go through record() instead
+	bool uploadFromHost(const Decoded& decoded, Texture& texture);
+	// makes image the texture's image, retiring the one it replaces
+	void adopt(Texture& texture, VkImage image, const Allocation& allocation, const Decoded& decoded);
+	void retireBatch();
+	VkDeviceSize getBudget() const;
+	// resident textures that still have a level to drop, least recently used first
+	std::vector<TextureHandle> findDropCandidates() const;
+	// least recently used first; only textures no frame in flight draws. false if none was left
+	bool evictUnused();
+	void evict(Texture& texture);
+	bool dropLevel(UploadBatch& upload, Texture& texture);
+	// reloads textures drawn last frame that were evicted or had levels dropped
+	void streamBack(VkDeviceSize budget);
+	void retire(Texture& texture);
+	void destroyRetired(bool all);
+	static VkDeviceSize stagingSize(const Decoded& decoded);
+	static VkDeviceSize imageSize(const Decoded& decoded);
+
+	const DeviceInfo* deviceInfo;
+	VkDevice device;
+	DeviceAllocator* allocator;
+	ThreadPool* threadPool;
+	VkCommandPool commandPool;
+	VkQueue queue;
+	bool linearBlit = false;
+	const HostImageCopy* hostImageCopy = nullptr;
+	// host copies need every level from the CPU, so the mip chain is built there
+	bool hostCopyMipmaps = false;
+	uint32_t framesInFlight = 2;
+	VkDeviceSize budget = 0;
+	uint32_t heapIndex = 0;
+
+	// render thread only
+	std::vector<Texture> textures;
+	UploadBatch batch;
+	std::vector<TextureHandle> batchTextures;
+	std::vector<Retired> retired;
+	VkDeviceSize usage = 0;
+	uint64_t frameNumber = 1;
+
+	// shared with the workers
+	std::mutex readyMutex;
+	std::condition_variable readyCondition;
+	std::vector<std::unique_ptr<Decoded>> ready;
+	uint32_t decoding = 0;
+};
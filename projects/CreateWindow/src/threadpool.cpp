@@ -0,0 +1,50 @@
+#include "threadpool.h"
+#include "trace.h"
+#include <algorithm>
+
+void ThreadPool::initialize(uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+	stopping = false;
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+void ThreadPool::destroy() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	condition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+	for (;;) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (jobs.empty()) {
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		TRACE_ZONE(TRACE_CATEGORY_RESOURCE, "worker job")
+		job();
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+// Fixed set of worker threads running jobs in submission order.
+// Jobs must not touch Vulkan objects that the render thread uses without synchronization.
+class ThreadPool {
+public:
+	// 0 uses every hardware thread but one, which is left to the render thread
+	void initialize(uint32_t threadCount = 0);
+	// runs the jobs still queued, then joins the workers
+	void destroy();
+	void submit(std::function<void()> job);
+	inline uint32_t getThreadCount() const { return static_cast<uint32_t>(threads.size()); }
+
+private:
+	void workerLoop();
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::function<void()>> jobs;
+	bool stopping = false;
+};
@@ -0,0 +1,633 @@
+#include "tiledviewer.h"
+#include "utils.h"
+#include "shader.h"
+#include "log.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+bool TiledViewer::initialize(VkPhysicalDevice physDevice_, VkDevice device_,
+	DeviceAllocator& allocator_, UniformRing& uniformRing_, ThreadPool& threadPool_,
+	VkCommandPool commandPool_, VkQueue queue_, VkPipelineCache pipelineCache_,
+	VkRenderPass renderPass, const char* pyramidPath)
+{
+	FUNCNAME()
+	physDevice = physDevice_;
+	device = device_;
+	allocator = &allocator_;
+	uniformRing = &uniformRing_;
+	threadPool = &threadPool_;
+	commandPool = commandPool_;
+	queue = queue_;
+	pipelineCache = pipelineCache_;
+	if (!pyramid.open(pyramidPath)) {
+		return false;
+	}
+	createAtlas();
+	createBuffers();
+	createDescriptorSet();
+	createPipeline(renderPass);
+	return true;
+}
+
+void TiledViewer::destroy() {
+	FUNCNAME()
+	batch.wait();
+	loadedTiles.clear();
+	vkDestroyPipeline(device, graphicsPipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	for (size_t i = 0; i < vertexBuffers.size(); ++i) {
+		destroyBuffer(device, *allocator, vertexBuffers[i], vertexAllocations[i]);
+	}
+	destroyBuffer(device, *allocator, indexBuffer, indexAllocation);
+	vkDestroySampler(device, atlasSampler, nullptr);
+	vkDestroyImageView(device, atlasImageView, nullptr);
+	destroyImage(device, *allocator, atlasImage, atlasAllocation);
+	pyramid.close();
+}
+
+void TiledViewer::recreate(VkRenderPass renderPass) {
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyPipeline(device, graphicsPipeline, nullptr);
+	createPipeline(renderPass);
+}
+
+void TiledViewer::pan(float dx, float dy) {
+	centerX += dx / scale;
+	centerY += dy / scale;
+	centerX = std::clamp(centerX, 0.0f, static_cast<float>(pyramid.getWidth()));
+	centerY = std::clamp(centerY, 0.0f, static_cast<float>(pyramid.getHeight()));
+}
+
+void TiledViewer::zoom(float factor) {
+	// from a quarter of the fitted size down to 64 screen pixels per image pixel
+	scale = std::clamp(scale * factor, minScale, 64.0f);
+}
+
+void TiledViewer::fit(VkExtent2D extent) {
+	float width = static_cast<float>(pyramid.getWidth());
+	float height = static_cast<float>(pyramid.getHeight());
+	scale = std::min(static_cast<float>(extent.width) / width, static_cast<float>(extent.height) / height);
+	minScale = std::min(scale / 4.0f, 1.0f);
+	centerX = width / 2.0f;
+	centerY = height / 2.0f;
+	fitted = true;
+}
+
+void TiledViewer::createAtlas() {
+	FUNCNAME()
+	// 4096 is the minimum maxImageDimension2D, so the atlas always fits
+	slotsPerRow = atlasSize / TILE_PYRAMID_TILE_SIZE;
+	slots.resize(static_cast<size_t>(slotsPerRow) * slotsPerRow);
+	createImage(device, *allocator, atlasSize, atlasSize, 1,
+		VK_FORMAT_B8G8R8A8_UNORM,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		MemoryClass::DeviceLocal,
+		atlasImage, atlasAllocation);
+	atlasImageView = createImageView(device, atlasImage, VK_FORMAT_B8G8R8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+
+	// every tile carries a border, so linear filtering never reads a neighbouring slot
+	VkSamplerCreateInfo samplerInfo {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_LINEAR,
+		.minFilter = VK_FILTER_LINEAR,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.mipLodBias = 0.0f,
+		.anisotropyEnable = VK_FALSE,
+		.maxAnisotropy = 1,
+		.compareEnable = VK_FALSE,
+		.compareOp = VK_COMPARE_OP_ALWAYS,
+		.minLod = 0.0f,
+		.maxLod = 0.0f,
+		.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+		.unnormalizedCoordinates = VK_FALSE
+	};
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &atlasSampler) != VK_SUCCESS) {
+		assert(0);
+	}
+}
+
+void TiledViewer::createBuffers() {
+	FUNCNAME()
+	uint32_t frameCount = uniformRing->getFrameCount();
+	VkDeviceSize vertexBufferSize = sizeof(Vertex) * 4 * MAX_QUADS;
+	vertexBuffers.resize(frameCount);
+	vertexAllocations.resize(frameCount);
+	for (uint32_t i = 0; i < frameCount; ++i) {
+		createBuffer(device, *allocator, vertexBufferSize,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			MemoryClass::Dynamic,
+			vertexBuffers[i], vertexAllocations[i]);
+	}
+
+	std::vector<uint16_t> indices(6 * MAX_QUADS);
+	for (uint32_t quad = 0; quad < MAX_QUADS; ++quad) {
+		uint16_t base = static_cast<uint16_t>(quad * 4);
+		uint16_t quadIndices[6] = { base, static_cast<uint16_t>(base + 1), static_cast<uint16_t>(base + 2),
+			base, static_cast<uint16_t>(base + 2), static_cast<uint16_t>(base + 3) };
+		std::copy(quadIndices, quadIndices + 6, indices.begin() + quad * 6);
+	}
+
+	// the coarsest tile shows the whole image and stays in slot 0, so there is always something to draw
+	uint32_t coarsest = pyramid.getLevelCount() - 1;
+	LoadedTile tile { tileKey(coarsest, 0, 0), {} };
+	const unsigned char* texels = pyramid.getTile(coarsest, 0, 0);
+	tile.texels.assign(texels, texels + TILE_PYRAMID_TILE_BYTES);
+
+	UploadBatch upload;
+	upload.begin(device, *allocator, commandPool, queue);
+	upload.createStaticBuffer(indices.data(), sizeof(uint16_t) * indices.size(),
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer, indexAllocation);
+	upload.transitionImageLayout(atlasImage, VK_FORMAT_B8G8R8A8_UNORM,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	recordTile(upload, tile, 0);
+	upload.transitionImageLayout(atlasImage, VK_FORMAT_B8G8R8A8_UNORM,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	upload.submit();
+	upload.wait();
+	slots[0] = { tile.key, 0, true };
+	residentTiles[tile.key] = 0;
+}
+
+void TiledViewer::requestTile(uint64_t key) {
+	if (pendingTiles.size() >= MAX_PENDING_TILES || !pendingTiles.insert(key).second) {
+		return;
+	}
+	threadPool->submit([this, key] {
+		TRACE_ZONE(TRACE_CATEGORY_RESOURCE, "read tile")
+		auto tile = std::make_unique<LoadedTile>();
+		tile->key = key;
+		// the page faults of the mapped pyramid happen here rather than on the render thread
+		const unsigned char* texels = pyramid.getTile(static_cast<uint32_t>(key >> 48),
+			static_cast<uint32_t>(key & 0xFFFFFF), static_cast<uint32_t>((key >> 24) & 0xFFFFFF));
+		tile->texels.assign(texels, texels + TILE_PYRAMID_TILE_BYTES);
+		std::lock_guard<std::mutex> lock(loadedMutex);
+		loadedTiles.push_back(std::move(tile));
+	});
+}
+
+uint32_t TiledViewer::evictSlot() {
+	uint32_t best = UINT32_MAX;
+	for (uint32_t i = 0; i < slots.size(); ++i) {
+		const Slot& slot = slots[i];
+		if (slot.key == UINT64_MAX) {
+			return i;
+		}
+		// tiles drawn last frame are likely visible again, evicting them would only thrash
+		if (slot.pinned || slot.lastUsed + 1 >= frameNumber) {
+			continue;
+		}
+		if (best == UINT32_MAX || slot.lastUsed < slots[best].lastUsed) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+void TiledViewer::recordTile(UploadBatch& upload, const LoadedTile& tile, uint32_t slot) {
+	UploadBatch::Staging staging = upload.stage(tile.texels.data(), TILE_PYRAMID_TILE_BYTES);
+	VkBufferImageCopy region {
+		.bufferOffset = staging.offset,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.mipLevel = 0,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		},
+		.imageOffset = {
+			static_cast<int32_t>((slot % slotsPerRow) * TILE_PYRAMID_TILE_SIZE),
+			static_cast<int32_t>((slot / slotsPerRow) * TILE_PYRAMID_TILE_SIZE),
+			0
+		},
+		.imageExtent = { TILE_PYRAMID_TILE_SIZE, TILE_PYRAMID_TILE_SIZE, 1 }
+	};
+	upload.copyBufferToImage(staging.buffer, atlasImage, 1, &region);
+}
+
+void TiledViewer::uploadTiles() {
+	// one batch in flight; tiles that arrive meanwhile wait for the next frame
+	if (!batch.poll()) {
+		return;
+	}
+	std::vector<std::unique_ptr<LoadedTile>> tiles;
+	{
+		std::lock_guard<std::mutex> lock(loadedMutex);
+		size_t count = std::min<size_t>(loadedTiles.size(), MAX_UPLOADS_PER_FRAME);
+		tiles.assign(std::make_move_iterator(loadedTiles.begin()), std::make_move_iterator(loadedTiles.begin() + count));
+		loadedTiles.erase(loadedTiles.begin(), loadedTiles.begin() + count);
+	}
+	if (tiles.empty()) {
+		return;
+	}
+
+	TRACE_ZONE(TRACE_CATEGORY_RESOURCE, "tile uploads")
+	// the batch is submitted before this frame's draws on the same queue, and the barriers order it
+	// after the draws of earlier frames, so a slot can be reused as soon as it is recorded
+	batch.begin(device, *allocator, commandPool, queue);
+	batch.transitionImageLayout(atlasImage, VK_FORMAT_B8G8R8A8_UNORM,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	for (const std::unique_ptr<LoadedTile>& tile : tiles) {
+		pendingTiles.erase(tile->key);
+		uint32_t slot = evictSlot();
+		if (slot == UINT32_MAX) {
+			// every slot is in view; the tile is requested again once one frees up
+			continue;
+		}
+		if (slots[slot].key != UINT64_MAX) {
+			residentTiles.erase(slots[slot].key);
+		}
+		recordTile(batch, *tile, slot);
+		slots[slot] = { tile->key, frameNumber, false };
+		residentTiles[tile->key] = slot;
+	}
+	batch.transitionImageLayout(atlasImage, VK_FORMAT_B8G8R8A8_UNORM,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	batch.submit();
+}
+
+TiledViewer::Rect TiledViewer::tileRect(uint32_t level, uint32_t x, uint32_t y) const {
+	const TilePyramidLevel& info = pyramid.getLevel(level);
+	float toLevel0X = static_cast<float>(pyramid.getWidth()) / static_cast<float>(info.width);
+	float toLevel0Y = static_cast<float>(pyramid.getHeight()) / static_cast<float>(info.height);
+	return {
+		static_cast<float>(x * TILE_PYRAMID_CONTENT) * toLevel0X,
+		static_cast<float>(y * TILE_PYRAMID_CONTENT) * toLevel0Y,
+		static_cast<float>(std::min((x + 1) * TILE_PYRAMID_CONTENT, info.width)) * toLevel0X,
+		static_cast<float>(std::min((y + 1) * TILE_PYRAMID_CONTENT, info.height)) * toLevel0Y
+	};
+}
+
+void TiledViewer::addQuad(const Rect& area, uint64_t key, uint32_t slot) {
+	if (quadCount == MAX_QUADS) {
+		return;
+	}
+	uint32_t level = static_cast<uint32_t>(key >> 48);
+	uint32_t tileX = static_cast<uint32_t>(key & 0xFFFFFF);
+	uint32_t tileY = static_cast<uint32_t>((key >> 24) & 0xFFFFFF);
+	const TilePyramidLevel& info = pyramid.getLevel(level);
+	float toLevelX = static_cast<float>(info.width) / static_cast<float>(pyramid.getWidth());
+	float toLevelY = static_cast<float>(info.height) / static_cast<float>(pyramid.getHeight());
+	// texel (0, 0) of the slot is the border texel left of and above the tile content
+	float originX = static_cast<float>((slot % slotsPerRow) * TILE_PYRAMID_TILE_SIZE + TILE_PYRAMID_BORDER)
+		- static_cast<float>(tileX * TILE_PYRAMID_CONTENT);
+	float originY = static_cast<float>((slot / slotsPerRow) * TILE_PYRAMID_TILE_SIZE + TILE_PYRAMID_BORDER)
+		- static_cast<float>(tileY * TILE_PYRAMID_CONTENT);
+	float invAtlas = 1.0f / static_cast<float>(atlasSize);
+	float u0 = (originX + area.x0 * toLevelX) * invAtlas;
+	float v0 = (originY + area.y0 * toLevelY) * invAtlas;
+	float u1 = (originX + area.x1 * toLevelX) * invAtlas;
+	float v1 = (originY + area.y1 * toLevelY) * invAtlas;
+
+	const glm::vec3 white(1.0f, 1.0f, 1.0f);
+	Vertex* quad = vertices + quadCount * 4;
+	quad[0] = { { area.x0, area.y0, 0.0f }, white, { u0, v0 } };
+	quad[1] = { { area.x1, area.y0, 0.0f }, white, { u1, v0 } };
+	quad[2] = { { area.x1, area.y1, 0.0f }, white, { u1, v1 } };
+	quad[3] = { { area.x0, area.y1, 0.0f }, white, { u0, v1 } };
+	++quadCount;
+}
+
+void TiledViewer::update(uint32_t frame, VkExtent2D extent) {
+	TRACE_ZONE(TRACE_CATEGORY_FRAME, "tiled viewer")
+	if (!fitted) {
+		fit(extent);
+	}
+	currentFrame = frame;
+	++frameNumber;
+	uploadTiles();
+
+	// the finest level has more texels than there are pixels, so stop at the first level that
+	// still has a texel per screen pixel
+	float width = static_cast<float>(pyramid.getWidth());
+	uint32_t level = 0;
+	while (level + 1 < pyramid.getLevelCount()
+		&& scale * width / static_cast<float>(pyramid.getLevel(level + 1).width) <= 1.0f) {
+		++level;
+	}
+	const TilePyramidLevel& info = pyramid.getLevel(level);
+
+	float halfWidth = static_cast<float>(extent.width) / (2.0f * scale);
+	float halfHeight = static_cast<float>(extent.height) / (2.0f * scale);
+	float toLevelX = static_cast<float>(info.width) / width;
+	float toLevelY = static_cast<float>(info.height) / static_cast<float>(pyramid.getHeight());
+	auto tileRange = [](float begin, float end, float toLevel, uint32_t tileCount, uint32_t& first, uint32_t& last) {
+		float content = static_cast<float>(TILE_PYRAMID_CONTENT);
+		first = static_cast<uint32_t>(std::clamp(std::floor(begin * toLevel / content), 0.0f, static_cast<float>(tileCount - 1)));
+		last = static_cast<uint32_t>(std::clamp(std::floor(end * toLevel / content), 0.0f, static_cast<float>(tileCount - 1)));
+	};
+	uint32_t firstX, lastX, firstY, lastY;
+	tileRange(centerX - halfWidth, centerX + halfWidth, toLevelX, info.tilesX, firstX, lastX);
+	tileRange(centerY - halfHeight, centerY + halfHeight, toLevelY, info.tilesY, firstY, lastY);
+
+	// tiles near the center are requested first
+	std::vector<std::pair<float, uint64_t>> visible;
+	for (uint32_t y = firstY; y <= lastY; ++y) {
+		for (uint32_t x = firstX; x <= lastX; ++x) {
+			Rect rect = tileRect(level, x, y);
+			float dx = (rect.x0 + rect.x1) / 2.0f - centerX;
+			float dy = (rect.y0 + rect.y1) / 2.0f - centerY;
+			visible.push_back({ dx * dx + dy * dy, tileKey(level, x, y) });
+		}
+	}
+	std::sort(visible.begin(), visible.end());
+
+	vertices = static_cast<Vertex*>(vertexAllocations[frame].mapped);
+	quadCount = 0;
+	for (const auto& entry : visible) {
+		uint32_t x = static_cast<uint32_t>(entry.second & 0xFFFFFF);
+		uint32_t y = static_cast<uint32_t>((entry.second >> 24) & 0xFFFFFF);
+		Rect rect = tileRect(level, x, y);
+		auto resident = residentTiles.find(entry.second);
+		if (resident == residentTiles.end()) {
+			requestTile(entry.second);
+			// a coarser tile covering the same area stands in; the coarsest one is always cached
+			for (uint32_t coarser = level + 1; coarser < pyramid.getLevelCount(); ++coarser) {
+				uint32_t shift = coarser - level;
+				resident = residentTiles.find(tileKey(coarser, x >> shift, y >> shift));
+				if (resident != residentTiles.end()) {
+					break;
+				}
+			}
+		}
+		if (resident != residentTiles.end()) {
+			slots[resident->second].lastUsed = frameNumber;
+			addQuad(rect, resident->first, resident->second);
+		}
+	}
+	// dynamic memory is not guaranteed to be coherent
+	if (quadCount != 0) {
+		allocator->flush(vertexAllocations[frame], 0, quadCount * 4 * sizeof(Vertex));
+	}
+
+	// level-0 pixels to clip space, y pointing down like the image rows
+	glm::mat4 projection = glm::scale(glm::mat4(1.0f),
+		glm::vec3(2.0f * scale / static_cast<float>(extent.width), 2.0f * scale / static_cast<float>(extent.height), 1.0f));
+	glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(-centerX, -centerY, 0.0f));
+	glm::mat4 mvp = projection * view;
+	uniformOffset = uniformRing->push(&mvp, sizeof(mvp));
+}
+
+void TiledViewer::commitCommands(VkCommandBuffer commandBuffer) {
+	if (quadCount == 0) {
+		return;
+	}
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+		pipelineLayout, 0, 1, &descriptorSet, 1, &uniformOffset);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffers[currentFrame], &offset);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+	vkCmdDrawIndexed(commandBuffer, quadCount * 6, 1, 0, 0, 0);
+}
+
+void TiledViewer::createDescriptorSet() {
+	FUNCNAME()
+	{
+		VkDescriptorPoolSize poolSizes[2] {
+			{
+				.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.descriptorCount = 1
+			},
+			{
+				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = 1
+			}
+		};
+		VkDescriptorPoolCreateInfo poolInfo {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.maxSets = 1,
+			.poolSizeCount = 2,
+			.pPoolSizes = poolSizes
+		};
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			assert(0);
+		}
+	}
+	{
+		VkDescriptorSetLayoutBinding bindings[2] = {
+			{
+				.binding = 0,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+				.pImmutableSamplers = nullptr
+			},
+			{
+				.binding = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+				.pImmutableSamplers = nullptr
+			}
+		};
+		VkDescriptorSetLayoutCreateInfo layoutInfo {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = 2,
+			.pBindings = bindings
+		};
+		if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			assert(0);
+		}
+	}
+	{
+		VkDescriptorSetAllocateInfo allocInfo {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.descriptorPool = descriptorPool,
+			.descriptorSetCount = 1,
+			.pSetLayouts = &descriptorSetLayout
+		};
+		if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
+			assert(0);
+		}
+	}
+	// the atlas never changes, only its contents do
+	{
+		VkDescriptorBufferInfo bufferInfo {
+			.buffer = uniformRing->getBuffer(),
+			.offset = 0,
+			.range = sizeof(glm::mat4)
+		};
+		VkDescriptorImageInfo imageInfo {
+			.sampler = atlasSampler,
+			.imageView = atlasImageView,
+			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		};
+		VkWriteDescriptorSet descriptorWrites[2] {
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = descriptorSet,
+				.dstBinding = 0,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.pImageInfo = nullptr,
+				.pBufferInfo = &bufferInfo,
+				.pTexelBufferView = nullptr
+			},
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = descriptorSet,
+				.dstBinding = 1,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.pImageInfo = &imageInfo,
+				.pBufferInfo = nullptr,
+				.pTexelBufferView = nullptr
+			}
+		};
+		vkUpdateDescriptorSets(device, 2, descriptorWrites, 0, nullptr);
+	}
+}
+
+void TiledViewer::createPipeline(VkRenderPass renderPass) {
+	FUNCNAME()
+	Shader shader(device);
+	shader.loadVertexShader("shader/vert.spv");
+	shader.loadFragmentShader("shader/frag.spv");
+
+	VkPipelineShaderStageCreateInfo shaderStages[] = {
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_VERTEX_BIT,
+			.module = shader.getVertexShaderModule(),
+			.pName = "main"
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.module = shader.getFragmentShaderModule(),
+			.pName = "main"
+		}
+	};
+
+	auto bindingDescription = Vertex::getBindingDescription();
+	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+		.vertexBindingDescriptionCount = 1,
+		.pVertexBindingDescriptions = &bindingDescription,
+		.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size()),
+		.pVertexAttributeDescriptions = attributeDescriptions.data()
+	};
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+		.primitiveRestartEnable = VK_FALSE
+	};
+
+	VkPipelineViewportStateCreateInfo viewportState {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+		.viewportCount = 1,
+		.pViewports = nullptr,
+		.scissorCount = 1,
+		.pScissors = nullptr
+	};
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		.dynamicStateCount = 2,
+		.pDynamicStates = dynamicStates
+	};
+
+	// flat quads in image space: no culling and no depth
+	VkPipelineRasterizationStateCreateInfo rasterizer {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+		.depthClampEnable = VK_FALSE,
+		.rasterizerDiscardEnable = VK_FALSE,
+		.polygonMode = VK_POLYGON_MODE_FILL,
+		.cullMode = VK_CULL_MODE_NONE,
+		.frontFace = VK_FRONT_FACE_CLOCKWISE,
+		.depthBiasEnable = VK_FALSE,
+		.depthBiasConstantFactor = 0.0f,
+		.depthBiasClamp = 0.0f,
+		.depthBiasSlopeFactor = 0.0f,
+		.lineWidth = 1.0f
+	};
+
+	VkPipelineMultisampleStateCreateInfo multisampling {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+		.sampleShadingEnable = VK_FALSE,
+		.minSampleShading = 1.0f,
+		.pSampleMask = nullptr,
+		.alphaToCoverageEnable = VK_FALSE,
+		.alphaToOneEnable = VK_FALSE
+	};
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment {
+		.blendEnable = VK_FALSE,
+		.srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+		.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+		.colorBlendOp = VK_BLEND_OP_ADD,
+		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+		.alphaBlendOp = VK_BLEND_OP_ADD,
+		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+	};
+
+	VkPipelineColorBlendStateCreateInfo colorBlending {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+		.logicOpEnable = VK_FALSE,
+		.logicOp = VK_LOGIC_OP_COPY,
+		.attachmentCount = 1,
+		.pAttachments = &colorBlendAttachment,
+		.blendConstants = { 0.0f, 0.0f, 0.0f, 0.0f }
+	};
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+		.depthTestEnable = VK_FALSE,
+		.depthWriteEnable = VK_FALSE,
+		.depthCompareOp = VK_COMPARE_OP_ALWAYS,
+		.depthBoundsTestEnable = VK_FALSE,
+		.stencilTestEnable = VK_FALSE,
+		.front = {},
+		.back = {},
+		.minDepthBounds = 0.0f,
+		.maxDepthBounds = 1.0f
+	};
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &descriptorSetLayout,
+		.pushConstantRangeCount = 0,
+		.pPushConstantRanges = nullptr
+	};
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		assert(0);
+	}
+
+	VkGraphicsPipelineCreateInfo pipelineInfo {
+		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+		.stageCount = 2,
+		.pStages = shaderStages,
+		.pVertexInputState = &vertexInputInfo,
+		.pInputAssemblyState = &inputAssembly,
+		.pViewportState = &viewportState,
+		.pRasterizationState = &rasterizer,
+		.pMultisampleState = &multisampling,
+		.pDepthStencilState = &depthStencil,
+		.pColorBlendState = &colorBlending,
+		.pDynamicState = &dynamicState,
+		.layout = pipelineLayout,
+		.renderPass = renderPass,
+		.subpass = 0,
+		.basePipelineHandle = VK_NULL_HANDLE,
+		.basePipelineIndex = -1
+	};
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+		assert(0);
+	}
+}
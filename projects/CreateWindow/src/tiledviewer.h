@@ -0,0 +1,136 @@
+#pragma once
+
+#include "mesh.h"
+#include "tilepyramid.h"
+#include "threadpool.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+
+// Pans and zooms over an image of any size through a TilePyramid.
+// A fixed atlas of TILE_PYRAMID_TILE_SIZE slots on the GPU caches tiles with LRU eviction;
+// every frame the tiles visible at the current zoom are drawn as quads, missing ones are read on
+// the thread pool and, until they arrive, covered by the closest coarser tile already cached.
+// GPU memory is the atlas plus a vertex buffer per frame, however large the image is.
+//
+// Uses the same shaders and vertex layout as Mesh; the atlas is one 2D image rather than an array
+// so that the existing fragment shader can sample it.
+class TiledViewer {
+public:
+	// false, with nothing created, if the pyramid can't be opened
+	bool initialize(
+		VkPhysicalDevice physDevice,
+		VkDevice device,
+		DeviceAllocator& allocator,
+		UniformRing& uniformRing,
+		ThreadPool& threadPool,
+		VkCommandPool commandPool,
+		VkQueue queue,
+		VkPipelineCache pipelineCache,
+		VkRenderPass renderPass,
+		const char* pyramidPath);
+	// the thread pool must be destroyed first, so that no tile read is still running
+	void destroy();
+	void recreate(VkRenderPass renderPass);
+
+	// pixels are screen pixels; factor > 1 zooms in around the screen center
+	void pan(float dx, float dy);
+	void zoom(float factor);
+	// shows the whole image
+	void fit(VkExtent2D extent);
+
+	// call once the frame's fence has signaled: uploads arrived tiles, requests missing ones
+	// and writes this frame's quads
+	void update(uint32_t frame, VkExtent2D extent);
+	void commitCommands(VkCommandBuffer commandBuffer);
+
+private:
+	struct Slot {
+		uint64_t key = UINT64_MAX;
+		uint64_t lastUsed = 0;
+		bool pinned = false;
+	};
+	struct LoadedTile {
+		uint64_t key;
+		std::vector<unsigned char> texels;
+	};
+	struct Rect {
+		float x0, y0, x1, y1;
+	};
+
+	static constexpr uint32_t ATLAS_SIZE = 4096;
+	static constexpr uint32_t MAX_QUADS = 2048;
+	// bounds the memory held by reads that haven't been uploaded yet
+	static constexpr uint32_t MAX_PENDING_TILES = 32;
+	static constexpr uint32_t MAX_UPLOADS_PER_FRAME = 16;
+
+	static uint64_t tileKey(uint32_t level, uint32_t x, uint32_t y) {
+		return (static_cast<uint64_t>(level) << 48) | (static_cast<uint64_t>(y) << 24) | x;
+	}
+
+	void createAtlas();
+	void createBuffers();
+	void createDescriptorSet();
+	void createPipeline(VkRenderPass renderPass);
+	void requestTile(uint64_t key);
+	void uploadTiles();
+	void recordTile(UploadBatch& upload, const LoadedTile& tile, uint32_t slot);
+	// least recently used slot that isn't needed this frame, UINT32_MAX if there is none
+	uint32_t evictSlot();
+	// level-0 rectangle covered by the content of a tile
+	Rect tileRect(uint32_t level, uint32_t x, uint32_t y) const;
+	// draws area of the image from the cached tile key, which must contain it
+	void addQuad(const Rect& area, uint64_t key, uint32_t slot);
+
+	// association
+	VkPhysicalDevice physDevice;
+	VkDevice device;
+	DeviceAllocator* allocator;
+	UniformRing* uniformRing;
+	ThreadPool* threadPool;
+	VkCommandPool commandPool;
+	VkQueue queue;
+	VkPipelineCache pipelineCache;
+
+	TilePyramid pyramid;
+	uint32_t atlasSize = ATLAS_SIZE;
+	uint32_t slotsPerRow = 0;
+	VkImage atlasImage;
+	Allocation atlasAllocation;
+	VkImageView atlasImageView;
+	VkSampler atlasSampler;
+	std::vector<Slot> slots;
+	std::unordered_map<uint64_t, uint32_t> residentTiles;
+	std::unordered_set<uint64_t> pendingTiles;
+	UploadBatch batch;
+	uint64_t frameNumber = 1;
+
+	// shared with the workers
+	std::mutex loadedMutex;
+	std::vector<std::unique_ptr<LoadedTile>> loadedTiles;
+
+	// camera: level-0 pixel at the screen center and screen pixels per level-0 pixel
+	float centerX = 0.0f;
+	float centerY = 0.0f;
+	float scale = 1.0f;
+	float minScale = 1.0f;
+	// the first update() fits the image to the window
+	bool fitted = false;
+
+	// persistently mapped quads, one buffer per frame in flight
+	std::vector<VkBuffer> vertexBuffers;
+	std::vector<Allocation> vertexAllocations;
+	VkBuffer indexBuffer;
+	Allocation indexAllocation;
+	Vertex* vertices = nullptr;
+	uint32_t quadCount = 0;
+	uint32_t currentFrame = 0;
+	uint32_t uniformOffset = 0;
+
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorSet descriptorSet;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline graphicsPipeline;
+};
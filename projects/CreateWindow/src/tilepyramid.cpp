@@ -0,0 +1,194 @@
+#include "tilepyramid.h"
+#include "imageloader.h"
+#include "imagefilter.h"
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <algorithm>
+
+bool TilePyramid::open(const char* filename) {
+	close();
+	if (!file.open(filename)) {
+		std::cerr << "Error loading: " << filename << std::endl;
+		return false;
+	}
+	const unsigned char* data = file.getData();
+	size_t size = file.getSize();
+	if (size < sizeof(header)) {
+		close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != TILE_PYRAMID_MAGIC || header.version != TILE_PYRAMID_VERSION
+		|| header.tileSize != TILE_PYRAMID_TILE_SIZE || header.border != TILE_PYRAMID_BORDER
+		|| header.levelCount == 0 || header.levelCount > 32
+		|| size < sizeof(header) + header.levelCount * sizeof(TilePyramidLevel)) {
+		std::cerr << "TilePyramid: " << filename << " is not a version " << TILE_PYRAMID_VERSION << " tile pyramid" << std::endl;
+		close();
+		return false;
+	}
+	levels.resize(header.levelCount);
+	memcpy(levels.data(), data + sizeof(header), levels.size() * sizeof(TilePyramidLevel));
+	// getTile() and tileRect() index and divide with these, so every level has to be the one the
+	// header implies; the coarsest level is a single tile that the viewer keeps as the fallback
+	for (size_t i = 0; i < levels.size(); ++i) {
+		const TilePyramidLevel& level = levels[i];
+		uint32_t width = header.width;
+		uint32_t height = header.height;
+		uint64_t firstTile = 0;
+		if (i > 0) {
+			const TilePyramidLevel& previous = levels[i - 1];
+			width = std::max(previous.width / 2, 1u);
+			height = std::max(previous.height / 2, 1u);
+			firstTile = previous.firstTile + static_cast<uint64_t>(previous.tilesX) * previous.tilesY;
+		}
+		if (width == 0 || height == 0 || level.width != width || level.height != height
+			|| level.tilesX != (width + TILE_PYRAMID_CONTENT - 1) / TILE_PYRAMID_CONTENT
+			|| level.tilesY != (height + TILE_PYRAMID_CONTENT - 1) / TILE_PYRAMID_CONTENT
+			|| level.firstTile != firstTile) {
+			std::cerr << "TilePyramid: " << filename << " has a corrupt level " << i << std::endl;
+			close();
+			return false;
+		}
+	}
+	const TilePyramidLevel& last = levels.back();
+	if (last.tilesX != 1 || last.tilesY != 1) {
+		std::cerr << "TilePyramid: " << filename << " has no single-tile level" << std::endl;
+		close();
+		return false;
+	}
+	uint64_t tileCount = last.firstTile + static_cast<uint64_t>(last.tilesX) * last.tilesY;
+	if (header.tileDataOffset > size || (size - header.tileDataOffset) / TILE_PYRAMID_TILE_BYTES < tileCount) {
+		std::cerr << "TilePyramid: " << filename << " is truncated" << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void TilePyramid::close() {
+	file.close();
+	header = {};
+	levels.clear();
+}
+
+const unsigned char* TilePyramid::getTile(uint32_t level, uint32_t x, uint32_t y) const {
+	const TilePyramidLevel& info = levels[level];
+	uint64_t index = info.firstTile + static_cast<uint64_t>(y) * info.tilesX + x;
+	return file.getData() + header.tileDataOffset + index * TILE_PYRAMID_TILE_BYTES;
+}
+
+namespace {
+
+	// one tile of a level image, border texels clamped at the image edge
+	void extractTile(const unsigned char* image, uint32_t width, uint32_t height,
+		uint32_t tileX, uint32_t tileY, unsigned char* tile)
+	{
+		int64_t originX = static_cast<int64_t>(tileX) * TILE_PYRAMID_CONTENT - TILE_PYRAMID_BORDER;
+		int64_t originY = static_cast<int64_t>(tileY) * TILE_PYRAMID_CONTENT - TILE_PYRAMID_BORDER;
+		for (uint32_t y = 0; y < TILE_PYRAMID_TILE_SIZE; ++y) {
+			int64_t sourceY = std::clamp<int64_t>(originY + y, 0, height - 1);
+			const unsigned char* row = image + static_cast<size_t>(sourceY) * width * 4;
+			unsigned char* out = tile + static_cast<size_t>(y) * TILE_PYRAMID_TILE_SIZE * 4;
+			for (uint32_t x = 0; x < TILE_PYRAMID_TILE_SIZE; ++x) {
+				int64_t sourceX = std::clamp<int64_t>(originX + x, 0, width - 1);
+				memcpy(out + x * 4, row + sourceX * 4, 4);
+			}
+		}
+	}
+
+}
+
+bool buildTilePyramid(const char* imageFilename, const char* pyramidFilename) {
+	freeimage::ImageData image = freeimage::loadImage(imageFilename);
+	if (!image.isValid()) {
+		return false;
+	}
+	uint32_t width = static_cast<uint32_t>(image.width);
+	uint32_t height = static_cast<uint32_t>(image.height);
+	std::vector<unsigned char> current(static_cast<size_t>(width) * height * 4);
+	image.copyTo(current.data(), static_cast<size_t>(width) * 4);
+	image.unload();
+	// FreeImage delivers the bottom row first, tiles are stored top row first
+	size_t pitch = static_cast<size_t>(width) * 4;
+	for (uint32_t y = 0; y < height / 2; ++y) {
+		std::swap_ranges(current.begin() + y * pitch, current.begin() + (y + 1) * pitch,
+			current.begin() + (height - 1 - y) * pitch);
+	}
+
+	std::vector<TilePyramidLevel> levels;
+	uint64_t tileCount = 0;
+	for (uint32_t levelWidth = width, levelHeight = height;;) {
+		TilePyramidLevel level {
+			.width = levelWidth,
+			.height = levelHeight,
+			.tilesX = (levelWidth + TILE_PYRAMID_CONTENT - 1) / TILE_PYRAMID_CONTENT,
+			.tilesY = (levelHeight + TILE_PYRAMID_CONTENT - 1) / TILE_PYRAMID_CONTENT,
+			.firstTile = tileCount
+		};
+		levels.push_back(level);
+		tileCount += static_cast<uint64_t>(level.tilesX) * level.tilesY;
+		if (level.tilesX == 1 && level.tilesY == 1) {
+			break;
+		}
+		levelWidth = std::max(levelWidth / 2, 1u);
+		levelHeight = std::max(levelHeight / 2, 1u);
+	}
+
+	TilePyramidHeader header {
+		.magic = TILE_PYRAMID_MAGIC,
+		.version = TILE_PYRAMID_VERSION,
+		.width = width,
+		.height = height,
+		.tileSize = TILE_PYRAMID_TILE_SIZE,
+		.border = TILE_PYRAMID_BORDER,
+		.levelCount = static_cast<uint32_t>(levels.size()),
+		.reserved = 0,
+		.tileDataOffset = (sizeof(TilePyramidHeader) + levels.size() * sizeof(TilePyramidLevel) + 63) & ~static_cast<uint64_t>(63)
+	};
+	// write next to the final file and rename it into place once complete, so an interrupted
+	// build or a full disk never leaves a truncated pyramid behind
+	std::string tempFilename = std::string(pyramidFilename) + ".tmp";
+	std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "buildTilePyramid(): cannot write " << tempFilename << std::endl;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(TilePyramidLevel));
+	static const char padding[64] = {};
+	file.write(padding, static_cast<std::streamsize>(header.tileDataOffset - static_cast<uint64_t>(file.tellp())));
+
+	// each level is written from the previous one, so at most one and a half images are in memory
+	std::vector<unsigned char> tile(TILE_PYRAMID_TILE_BYTES);
+	std::vector<unsigned char> next;
+	for (size_t i = 0; i < levels.size(); ++i) {
+		const TilePyramidLevel& level = levels[i];
+		for (uint32_t y = 0; y < level.tilesY; ++y) {
+			for (uint32_t x = 0; x < level.tilesX; ++x) {
+				extractTile(current.data(), level.width, level.height, x, y, tile.data());
+				file.write(reinterpret_cast<const char*>(tile.data()), tile.size());
+			}
+		}
+		if (i + 1 < levels.size()) {
+			next.resize(static_cast<size_t>(levels[i + 1].width) * levels[i + 1].height * 4);
+			downsampleBox(current.data(), level.width, level.height, next.data());
+			std::swap(current, next);
+		}
+	}
+	file.close();
+	std::error_code error;
+	if (!file.good()) {
+		std::cerr << "buildTilePyramid(): cannot write " << tempFilename << std::endl;
+		std::filesystem::remove(tempFilename, error);
+		return false;
+	}
+	std::filesystem::rename(tempFilename, pyramidFilename, error);
+	if (error) {
+		std::cerr << "buildTilePyramid(): cannot replace " << pyramidFilename << ": " << error.message() << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "mappedfile.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Multi-resolution tile pyramid of one large image (.tiles), written once and then mapped.
+// Level 0 is the full image and every further level is half the size, down to a level that fits
+// one tile. Tiles are TILE_PYRAMID_TILE_SIZE squared BGRA8 texels, top row first: TILE_PYRAMID_CONTENT
+// texels of image plus a TILE_PYRAMID_BORDER copied from the neighbours, so tiles can sit side by side
+// in an atlas and still be filtered linearly without seams.
+
+const uint32_t TILE_PYRAMID_MAGIC = 0x52595054; // "TPYR"
+const uint32_t TILE_PYRAMID_VERSION = 1;
+const uint32_t TILE_PYRAMID_TILE_SIZE = 256;
+const uint32_t TILE_PYRAMID_BORDER = 1;
+const uint32_t TILE_PYRAMID_CONTENT = TILE_PYRAMID_TILE_SIZE - 2 * TILE_PYRAMID_BORDER;
+const size_t TILE_PYRAMID_TILE_BYTES = static_cast<size_t>(TILE_PYRAMID_TILE_SIZE) * TILE_PYRAMID_TILE_SIZE * 4;
+
+struct TilePyramidHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t tileSize;
+	uint32_t border;
+	uint32_t levelCount;
+	uint32_t reserved;
+	// file offset of the first tile, a multiple of 64
+	uint64_t tileDataOffset;
+};
+
+struct TilePyramidLevel {
+	uint32_t width;
+	uint32_t height;
+	uint32_t tilesX;
+	uint32_t tilesY;
+	// index of the level's first tile; tiles are stored row by row
+	uint64_t firstTile;
+};
+
+// read side; the tiles are paged in from the file on first access
+class TilePyramid {
+public:
+	bool open(const char* filename);
+	void close();
+
+	inline uint32_t getWidth() const { return header.width; }
+	inline uint32_t getHeight() const { return header.height; }
+	inline uint32_t getLevelCount() const { return header.levelCount; }
+	inline const TilePyramidLevel& getLevel(uint32_t level) const { return levels[level]; }
+	// TILE_PYRAMID_TILE_BYTES bytes
+	const unsigned char* getTile(uint32_t level, uint32_t x, uint32_t y) const;
+
+private:
+	MappedFile file;
+	TilePyramidHeader header {};
+	std::vector<TilePyramidLevel> levels;
+};
+
+// Decodes imageFilename and writes its pyramid. Building needs the decoded image in memory
+// once; viewing the result afterwards does not.
+bool buildTilePyramid(const char* imageFilename, const char* pyramidFilename);
@@ -0,0 +1,136 @@
+#include "trace.h"
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+namespace trace {
+
+	namespace {
+
+		struct Event {
+			const char* name;
+			uint64_t begin;
+			uint64_t end;
+			uint32_t category;
+		};
+
+		// per thread, power of two; the oldest zones are overwritten once it is full.
+		// the buffer grows on demand up to this size, so short-lived threads stay small
+		const uint64_t BUFFER_CAPACITY = 1 << 16;
+
+		struct ThreadBuffer {
+			uint32_t threadId;
+			std::atomic<uint64_t> written { 0 };
+			std::vector<Event> events;
+		};
+
+		// buffers outlive their threads so that a late flush still sees them
+		struct Registry {
+			std::mutex mutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+		};
+
+		Registry& getRegistry() {
+			static Registry registry;
+			return registry;
+		}
+
+		ThreadBuffer* registerThread() {
+			auto buffer = std::make_unique<ThreadBuffer>();
+			buffer->events.reserve(64);
+			Registry& registry = getRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			buffer->threadId = static_cast<uint32_t>(registry.buffers.size());
+			registry.buffers.push_back(std::move(buffer));
+			return registry.buffers.back().get();
+		}
+
+		thread_local ThreadBuffer* threadBuffer = nullptr;
+
+		const char* categoryName(uint32_t category) {
+			switch (category) {
+			case TRACE_CATEGORY_FUNCTION: return "function";
+			case TRACE_CATEGORY_INIT: return "init";
+			case TRACE_CATEGORY_FRAME: return "frame";
+			case TRACE_CATEGORY_RESOURCE: return "resource";
+			default: return "other";
+			}
+		}
+
+		void writeEscaped(std::ostream& out, const char* text) {
+			for (; *text; ++text) {
+				if (*text == '"' || *text == '\\') {
+					out << '\\';
+				}
+				out << *text;
+			}
+		}
+
+	}
+
+	void record(uint32_t category, const char* name, uint64_t begin, uint64_t end) {
+		ThreadBuffer* buffer = threadBuffer;
+		if (!buffer) {
+			buffer = threadBuffer = registerThread();
+		}
+		// only this thread writes the buffer; the release store publishes the event to a flush
+		uint64_t index = buffer->written.load(std::memory_order_relaxed);
+		Event event { name, begin, end, category };
+		if (index < BUFFER_CAPACITY) {
+			buffer->events.push_back(event);
+		} else {
+			buffer->events[index & (BUFFER_CAPACITY - 1)] = event;
+		}
+		buffer->written.store(index + 1, std::memory_order_release);
+	}
+
+	bool writeChromeJson(const std::string& path) {
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open()) {
+			std::cerr << "trace: cannot write " << path << std::endl;
+			return false;
+		}
+
+		Registry& registry = getRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		uint64_t origin = UINT64_MAX;
+		for (const auto& buffer : registry.buffers) {
+			uint64_t written = buffer->written.load(std::memory_order_acquire);
+			uint64_t first = written > BUFFER_CAPACITY ? written - BUFFER_CAPACITY : 0;
+			for (uint64_t i = first; i < written; ++i) {
+				origin = std::min(origin, buffer->events[i & (BUFFER_CAPACITY - 1)].begin);
+			}
+		}
+
+		// timestamps are in microseconds; three decimals keep the nanoseconds
+		file << "{\"traceEvents\":[\n" << std::fixed << std::setprecision(3);
+		bool firstEvent = true;
+		uint64_t dropped = 0;
+		for (const auto& buffer : registry.buffers) {
+			uint64_t written = buffer->written.load(std::memory_order_acquire);
+			uint64_t first = written > BUFFER_CAPACITY ? written - BUFFER_CAPACITY : 0;
+			dropped += first;
+			for (uint64_t i = first; i < written; ++i) {
+				const Event& event = buffer->events[i & (BUFFER_CAPACITY - 1)];
+				file << (firstEvent ? "" : ",\n") << "{\"name\":\"";
+				writeEscaped(file, event.name);
+				file << "\",\"cat\":\"" << categoryName(event.category)
+					<< "\",\"ph\":\"X\",\"ts\":" << static_cast<double>(event.begin - origin) / 1000.0
+					<< ",\"dur\":" << static_cast<double>(event.end - event.begin) / 1000.0
+					<< ",\"pid\":0,\"tid\":" << buffer->threadId << "}";
+				firstEvent = false;
+			}
+		}
+		file << "\n]}\n";
+		if (dropped > 0) {
+			std::cerr << "trace: " << dropped << " oldest zones were overwritten" << std::endl;
+		}
+		return true;
+	}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+
+// Scoped-zone tracer.
+// Every thread appends completed zones to its own ring buffer, so recording is a clock read
+// and a store with no locks. trace::writeChromeJson() dumps all buffers in the Chrome
+// trace-event format (chrome://tracing, https://ui.perfetto.dev).
+//
+//	void Application::drawFrame() {
+//		TRACE_ZONE(TRACE_CATEGORY_FRAME, "drawFrame")
+//		...
+
+enum TraceCategory : uint32_t {
+	// FUNCNAME() zones
+	TRACE_CATEGORY_FUNCTION = 1 << 0,
+	TRACE_CATEGORY_INIT = 1 << 1,
+	TRACE_CATEGORY_FRAME = 1 << 2,
+	TRACE_CATEGORY_RESOURCE = 1 << 3,
+};
+
+// categories compiled in; zones of any other category compile to nothing
+#ifndef TRACE_CATEGORIES
+#define TRACE_CATEGORIES (TRACE_CATEGORY_FUNCTION | TRACE_CATEGORY_INIT | TRACE_CATEGORY_FRAME | TRACE_CATEGORY_RESOURCE)
+#endif
+
+namespace trace {
+
+	inline uint64_t now() {
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// name must outlive the trace, e.g. a string literal or __FUNCTION__
+	void record(uint32_t category, const char* name, uint64_t begin, uint64_t end);
+
+	// call while no other thread is recording; returns false if the file can't be written
+	bool writeChromeJson(const std::string& path);
+
+	template <uint32_t Category>
+	class Zone {
+	public:
+		explicit Zone(const char* name_) : name(name_) {
+			if constexpr (enabled) {
+				begin = now();
+			}
+		}
+		~Zone() {
+			if constexpr (enabled) {
+				record(Category, name, begin, now());
+			}
+		}
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		static constexpr bool enabled = (TRACE_CATEGORIES & Category) != 0;
+		const char* name;
+		uint64_t begin = 0;
+	};
+
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(category, name) trace::Zone<category> TRACE_CONCAT(__traceZone, __LINE__)(name);
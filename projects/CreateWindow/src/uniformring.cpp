@@ -0,0 +1,53 @@
+#include "uniformring.h"
+#include "utils.h"
+#include "log.h"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+void UniformRing::initialize(const DeviceInfo& deviceInfo, VkDevice device_, DeviceAllocator& allocator_,
+	uint32_t frameCount_, uint32_t maxObjects, VkDeviceSize maxObjectSize)
+{
+	FUNCNAME()
+	device = device_;
+	allocator = &allocator_;
+	frameCount = frameCount_;
+
+	alignment = deviceInfo.getLimits().minUniformBufferOffsetAlignment;
+	VkDeviceSize atomSize = deviceInfo.getLimits().nonCoherentAtomSize;
+	// slices start and end on nonCoherentAtomSize, so the flush of one frame, rounded out to whole
+	// atoms, never touches bytes of another. Both limits are powers of two, so the larger one is a
+	// multiple of the smaller
+	VkDeviceSize frameAlignment = std::max(alignment, atomSize);
+	frameSize = alignUp(alignUp(maxObjectSize, alignment) * maxObjects, frameAlignment);
+
+	// the BAR window, where there is one, saves the GPU from reading the uniforms over PCIe every draw
+	createBuffer(device, *allocator, frameSize * frameCount,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		MemoryClass::Dynamic,
+		buffer, bufferAllocation);
+}
+
+void UniformRing::destroy() {
+	destroyBuffer(device, *allocator, buffer, bufferAllocation);
+}
+
+void UniformRing::beginFrame(uint32_t frame) {
+	assert(frame < frameCount);
+	frameBegin = frameSize * frame;
+	cursor = frameBegin;
+}
+
+uint32_t UniformRing::push(const void* data, VkDeviceSize size) {
+	assert(cursor + size <= frameBegin + frameSize);
+	VkDeviceSize offset = cursor;
+	memcpy(static_cast<char*>(bufferAllocation.mapped) + offset, data, static_cast<size_t>(size));
+	cursor = alignUp(cursor + size, alignment);
+	return static_cast<uint32_t>(offset);
+}
+
+void UniformRing::endFrame() {
+	if (cursor > frameBegin) {
+		allocator->flush(bufferAllocation, frameBegin, cursor - frameBegin);
+	}
+}
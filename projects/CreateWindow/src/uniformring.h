@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "allocator.h"
+
+// One persistently mapped uniform buffer split into a slice per frame.
+// Per-object constants are bump-allocated from the current frame's slice and
+// bound through a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC offset, so the hot path
+// is a pointer bump and a memcpy with no driver calls.
+class UniformRing {
+public:
+	void initialize(const DeviceInfo& deviceInfo, VkDevice device, DeviceAllocator& allocator,
+		uint32_t frameCount, uint32_t maxObjects, VkDeviceSize maxObjectSize);
+	void destroy();
+
+	// the caller guarantees the GPU is done with this frame's previous contents
+	void beginFrame(uint32_t frame);
+	// copies data into the frame's slice and returns its dynamic offset
+	uint32_t push(const void* data, VkDeviceSize size);
+	// flushes what was pushed this frame when the memory isn't HOST_COHERENT
+	void endFrame();
+
+	inline VkBuffer getBuffer() const { return buffer; }
+	inline uint32_t getFrameCount() const { return frameCount; }
+
+private:
+	VkDevice device;
+	DeviceAllocator* allocator;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	Allocation bufferAllocation;
+	// minUniformBufferOffsetAlignment
+	VkDeviceSize alignment;
+	VkDeviceSize frameSize;
+	uint32_t frameCount;
+	VkDeviceSize frameBegin = 0;
+	VkDeviceSize cursor = 0;
+};
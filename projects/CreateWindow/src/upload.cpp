@@ -0,0 +1,147 @@
+#include "upload.h"
+#include "utils.h"
+#include "log.h"
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+void UploadBatch::begin(VkDevice device_, DeviceAllocator& allocator_, VkCommandPool commandPool_, VkQueue queue_) {
+	assert(!isPending());
+	device = device_;
+	allocator = &allocator_;
+	commandPool = commandPool_;
+	queue = queue_;
+	submitted = false;
+
+	VkCommandBufferAllocateInfo allocInfo {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = commandPool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1
+	};
+	if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		assert(0);
+	}
+	VkCommandBufferBeginInfo beginInfo {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	VkFenceCreateInfo fenceInfo { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+		assert(0);
+	}
+}
+
+UploadBatch::Staging UploadBatch::stage(VkDeviceSize size, VkDeviceSize alignment) {
+	assert(isPending() && !submitted);
+	for (StagingChunk& chunk : chunks) {
+		VkDeviceSize offset = alignUp(chunk.used, alignment);
+		if (offset + size <= chunk.size) {
+			chunk.used = offset + size;
+			return { chunk.buffer, offset, static_cast<char*>(chunk.allocation.mapped) + offset };
+		}
+	}
+	// oversized requests get a chunk of their own
+	StagingChunk chunk;
+	chunk.size = size > CHUNK_SIZE ? size : CHUNK_SIZE;
+	chunk.used = size;
+	createBuffer(device, *allocator, chunk.size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		MemoryClass::Staging,
+		chunk.buffer, chunk.allocation);
+	chunks.push_back(chunk);
+	return { chunk.buffer, 0, chunk.allocation.mapped };
+}
+
+UploadBatch::Staging UploadBatch::stage(const void* data, VkDeviceSize size) {
+	Staging staging = stage(size);
+	memcpy(staging.data, data, static_cast<size_t>(size));
+	return staging;
+}
+
+void UploadBatch::createStaticBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+	VkBuffer& buffer, Allocation& bufferAllocation) {
+	// host writes before the vkQueueSubmit that uses the buffer are visible to it without a barrier
+	if (allocator->isUnifiedMemory() && tryCreateBuffer(device, *allocator, size, usage,
+		MemoryClass::InPlace,
+		buffer, bufferAllocation)) {
+		memcpy(bufferAllocation.mapped, data, static_cast<size_t>(size));
+		allocator->flush(bufferAllocation);
+		return;
+	}
+	Staging staging = stage(data, size);
+	createBuffer(device, *allocator, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		MemoryClass::DeviceLocal,
+		buffer, bufferAllocation);
+	copyBuffer(staging.buffer, staging.offset, buffer, size);
+}
+
+void UploadBatch::copyBuffer(VkBuffer src, VkDeviceSize srcOffset, VkBuffer dst, VkDeviceSize size, VkDeviceSize dstOffset) {
+	VkBufferCopy copyRegion {
+		.srcOffset = srcOffset,
+		.dstOffset = dstOffset,
+		.size = size
+	};
+	vkCmdCopyBuffer(commandBuffer, src, dst, 1, &copyRegion);
+}
+
+void UploadBatch::copyBufferToImage(VkBuffer src, VkImage image, uint32_t regionCount, const VkBufferImageCopy* regions) {
+	vkCmdCopyBufferToImage(commandBuffer, src, image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, regions);
+}
+
+void UploadBatch::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout,
+	uint32_t mipLevels) {
+	cmdTransitionImageLayout(commandBuffer, image, format, oldLayout, newLayout, mipLevels);
+}
+
+void UploadBatch::submit() {
+	FUNCNAME()
+	assert(isPending() && !submitted);
+	vkEndCommandBuffer(commandBuffer);
+	VkSubmitInfo submitInfo {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &commandBuffer
+	};
+	if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+		assert(0);
+	}
+	submitted = true;
+}
+
+bool UploadBatch::poll() {
+	if (!isPending()) {
+		return true;
+	}
+	assert(submitted);
+	if (vkGetFenceStatus(device, fence) != VK_SUCCESS) {
+		return false;
+	}
+	release();
+	return true;
+}
+
+void UploadBatch::wait() {
+	FUNCNAME()
+	if (!isPending()) {
+		return;
+	}
+	assert(submitted);
+	vkWaitForFences(device, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	release();
+}
+
+void UploadBatch::release() {
+	for (StagingChunk& chunk : chunks) {
+		destroyBuffer(device, *allocator, chunk.buffer, chunk.allocation);
+	}
+	chunks.clear();
+	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+	vkDestroyFence(device, fence, nullptr);
+	commandBuffer = VK_NULL_HANDLE;
+	fence = VK_NULL_HANDLE;
+	submitted = false;
+}
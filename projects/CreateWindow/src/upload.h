@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "allocator.h"
+
+// Records staging copies and layout transitions of many resources into one command buffer,
+// submitted once with a fence. Staging memory stays alive until the batch has completed.
+//
+//	UploadBatch upload;
+//	upload.begin(device, allocator, commandPool, queue);
+//	auto staging = upload.stage(data, size);
+//	upload.copyBuffer(staging.buffer, staging.offset, dst, size);
+//	upload.submit();
+//	upload.wait(); // or poll() once per frame
+class UploadBatch {
+public:
+	struct Staging {
+		VkBuffer buffer;
+		VkDeviceSize offset;
+		void* data;
+	};
+
+	void begin(VkDevice device, DeviceAllocator& allocator, VkCommandPool commandPool, VkQueue queue);
+
+	// host visible scratch memory, valid until the batch completes
+	Staging stage(VkDeviceSize size, VkDeviceSize alignment = 16);
+	Staging stage(const void* data, VkDeviceSize size);
+
+	// a buffer the GPU only reads, filled with data. On unified memory it is written in place and
+	// needs no command at all; otherwise data is staged and copied into DEVICE_LOCAL memory
+	void createStaticBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+		VkBuffer& buffer, Allocation& bufferAllocation);
+
+	void copyBuffer(VkBuffer src, VkDeviceSize srcOffset, VkBuffer dst, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+	void copyBufferToImage(VkBuffer src, VkImage image, uint32_t regionCount, const VkBufferImageCopy* regions);
+	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout,
+		uint32_t mipLevels = 1);
+	inline VkCommandBuffer getCommandBuffer() const { return commandBuffer; }
+
+	void submit();
+	// true once the GPU has finished; releases the staging memory at that point
+	bool poll();
+	// blocks until the GPU has finished, then releases the staging memory
+	void wait();
+	inline bool isPending() const { return fence != VK_NULL_HANDLE; }
+
+private:
+	struct StagingChunk {
+		VkBuffer buffer;
+		Allocation allocation;
+		VkDeviceSize size;
+		VkDeviceSize used;
+	};
+	static constexpr VkDeviceSize CHUNK_SIZE = 16ull * 1024 * 1024;
+
+	void release();
+
+	VkDevice device = VK_NULL_HANDLE;
+	DeviceAllocator* allocator = nullptr;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkQueue queue = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE;
+	bool submitted = false;
+	std::vector<StagingChunk> chunks;
+};
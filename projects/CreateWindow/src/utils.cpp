@@ -1,8 +1,10 @@
 #include "utils.h"
 #include "log.h"
 #include <stdexcept>
+#include <algorithm>
 
-VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) {
+VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+	uint32_t mipLevels) {
 	VkImageViewCreateInfo viewInfo{
 		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
 		.image = image,
@@ -11,7 +13,7 @@ VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkI
 		.subresourceRange = {
 			.aspectMask = aspectFlags,
 			.baseMipLevel = 0,
-			.levelCount = 1,
+			.levelCount = mipLevels,
 			.baseArrayLayer = 0,
 			.layerCount = 1
 		}
@@ -23,53 +25,17 @@ VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkI
 	return imageView;
 }
 
-VkCommandBuffer beginSingleTimeCommands(VkDevice device, VkCommandPool commandPool) {
-	VkCommandBufferAllocateInfo allocInfo {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.commandPool = commandPool,
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandBufferCount = 1
-	};
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-	VkCommandBufferBeginInfo beginInfo {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
-	};
-
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
-	return commandBuffer;
-}
-
-void endSingleTimeCommands(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue, VkCommandBuffer commandBuffer) {
-	vkEndCommandBuffer(commandBuffer);
-	VkSubmitInfo submitInfo {
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &commandBuffer
-	};
-	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
-	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-}
-
-uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-	FUNCNAME()
-		VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
-		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-			return i;
-		}
+void createBuffer(VkDevice device, DeviceAllocator& allocator,
+	VkDeviceSize size, VkBufferUsageFlags usage, const MemoryUsage& memoryUsage,
+	VkBuffer& buffer, Allocation& bufferAllocation) {
+	if (!tryCreateBuffer(device, allocator, size, usage, memoryUsage, buffer, bufferAllocation)) {
+		assert(0);
 	}
-	assert(0);
-	return 0xffffffff;
 }
 
-void createBuffer(VkPhysicalDevice physDevice, VkDevice device,
-	VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-	VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+bool tryCreateBuffer(VkDevice device, DeviceAllocator& allocator,
+	VkDeviceSize size, VkBufferUsageFlags usage, const MemoryUsage& memoryUsage,
+	VkBuffer& buffer, Allocation& bufferAllocation) {
 	FUNCNAME()
 	VkBufferCreateInfo bufferInfo {
 		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -83,33 +49,27 @@ void createBuffer(VkPhysicalDevice physDevice, VkDevice device,
 	}
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-	VkMemoryAllocateInfo allocInfo {
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = memRequirements.size,
-		.memoryTypeIndex = findMemoryType(physDevice, memRequirements.memoryTypeBits, properties)
-	};
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-		assert(0);
+	if (!allocator.tryAllocate(memRequirements, memoryUsage, AllocationKind::Linear, bufferAllocation)) {
+		vkDestroyBuffer(device, buffer, nullptr);
+		buffer = VK_NULL_HANDLE;
+		return false;
 	}
-	vkBindBufferMemory(device, buffer, bufferMemory, 0);
+	vkBindBufferMemory(device, buffer, bufferAllocation.memory, bufferAllocation.offset);
+	return true;
 }
 
-void copyBuffer(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue, VkBuffer src, VkBuffer dst, VkDeviceSize size) {
-	FUNCNAME()
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
-	VkBufferCopy copyRegion { .size = size };
-	vkCmdCopyBuffer(commandBuffer, src, dst, 1, &copyRegion);
-	endSingleTimeCommands(device, commandPool, graphicsQueue, commandBuffer);
+void destroyBuffer(VkDevice device, DeviceAllocator& allocator, VkBuffer buffer, Allocation& bufferAllocation) {
+	vkDestroyBuffer(device, buffer, nullptr);
+	allocator.free(bufferAllocation);
 }
 
-VkFormat findSupportedFormat(VkPhysicalDevice physDevice,
+VkFormat findSupportedFormat(const DeviceInfo& deviceInfo,
 	const std::vector<VkFormat>& candidates,
 	VkImageTiling tiling, VkFormatFeatureFlags features)
 {
 	FUNCNAME()
 	for (VkFormat format : candidates) {
-		VkFormatProperties props;
-		vkGetPhysicalDeviceFormatProperties(physDevice, format, &props);
+		VkFormatProperties props = deviceInfo.getFormatProperties(format);
 		if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features) {
 			return format;
 		} else if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features) {
@@ -120,9 +80,9 @@ VkFormat findSupportedFormat(VkPhysicalDevice physDevice,
 	return VK_FORMAT_UNDEFINED;
 }
 
-VkFormat findDepthFormat(VkPhysicalDevice physDevice) {
+VkFormat findDepthFormat(const DeviceInfo& deviceInfo) {
 	return findSupportedFormat(
-		physDevice,
+		deviceInfo,
 		{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
@@ -134,7 +94,13 @@ bool hasStencilComponent(VkFormat format) {
 		|| format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
-void createImage(VkPhysicalDevice physDevice, VkDevice device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+void createImage(VkDevice device, DeviceAllocator& allocator, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, const MemoryUsage& memoryUsage, VkImage& image, Allocation& imageAllocation) {
+	if (!tryCreateImage(device, allocator, width, height, mipLevels, format, tiling, usage, memoryUsage, image, imageAllocation)) {
+		assert(0);
+	}
+}
+
+bool tryCreateImage(VkDevice device, DeviceAllocator& allocator, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, const MemoryUsage& memoryUsage, VkImage& image, Allocation& imageAllocation) {
 	VkImageCreateInfo imageInfo = {
 		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
 		.imageType = VK_IMAGE_TYPE_2D,
@@ -144,7 +110,7 @@ void createImage(VkPhysicalDevice physDevice, VkDevice device, uint32_t width, u
 			.height = height,
 			.depth = 1
 		},
-		.mipLevels = 1,
+		.mipLevels = mipLevels,
 		.arrayLayers = 1,
 		.samples = VK_SAMPLE_COUNT_1_BIT,
 		.tiling = tiling,
@@ -159,27 +125,23 @@ void createImage(VkPhysicalDevice physDevice, VkDevice device, uint32_t width, u
 
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(device, image, &memRequirements);
-
-	VkMemoryAllocateInfo allocInfo {
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = memRequirements.size,
-		.memoryTypeIndex = findMemoryType(physDevice, memRequirements.memoryTypeBits, properties)
-	};
-
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate image memory!");
+	if (!allocator.tryAllocate(memRequirements, memoryUsage,
+		tiling == VK_IMAGE_TILING_OPTIMAL ? AllocationKind::Optimal : AllocationKind::Linear, imageAllocation)) {
+		vkDestroyImage(device, image, nullptr);
+		image = VK_NULL_HANDLE;
+		return false;
 	}
-
-	vkBindImageMemory(device, image, imageMemory, 0);
+	vkBindImageMemory(device, image, imageAllocation.memory, imageAllocation.offset);
+	return true;
 }
 
-void transitionImageLayout(
-	VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue,
-	VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-	FUNCNAME()
-	static_cast<void>(format);
+void destroyImage(VkDevice device, DeviceAllocator& allocator, VkImage image, Allocation& imageAllocation) {
+	vkDestroyImage(device, image, nullptr);
+	allocator.free(imageAllocation);
+}
 
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
+void cmdTransitionImageLayout(VkCommandBuffer commandBuffer,
+	VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
 	VkImageMemoryBarrier barrier {
 		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
 		.oldLayout = oldLayout,
@@ -190,7 +152,7 @@ void transitionImageLayout(
 		.subresourceRange = {
 			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
 			.baseMipLevel = 0,
-			.levelCount = 1,
+			.levelCount = mipLevels,
 			.baseArrayLayer = 0,
 			.layerCount = 1
 		}
@@ -211,6 +173,20 @@ void transitionImageLayout(
 
 		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	} else if (oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+		// updating a sampled image in place: earlier draws must have finished reading it
+		barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		sourceStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	} else if (oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+		// copying out of a sampled image, e.g. into a smaller one
+		barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		sourceStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
 	} else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
 		barrier.srcAccessMask = 0;
 		barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
@@ -239,5 +215,91 @@ void transitionImageLayout(
 		0, nullptr,
 		1, &barrier
 	);
-	endSingleTimeCommands(device, commandPool, graphicsQueue, commandBuffer);
-}
\ No newline at end of file
+}
+
+bool supportsLinearBlit(const DeviceInfo& deviceInfo, VkFormat format) {
+	VkFormatProperties props = deviceInfo.getFormatProperties(format);
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT
+		| VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (props.optimalTilingFeatures & required) == required;
+}
+
+bool supportsSampledImage(const DeviceInfo& deviceInfo, VkFormat format) {
+	VkFormatProperties props = deviceInfo.getFormatProperties(format);
+	return (props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+void cmdGenerateMipmaps(VkCommandBuffer commandBuffer, VkImage image,
+	uint32_t width, uint32_t height, uint32_t mipLevels) {
+	VkImageMemoryBarrier barrier {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+
+	int32_t mipWidth = static_cast<int32_t>(width);
+	int32_t mipHeight = static_cast<int32_t>(height);
+	for (uint32_t i = 1; i < mipLevels; ++i) {
+		// level i-1 was just written, turn it into the blit source of level i
+		barrier.subresourceRange.baseMipLevel = i - 1;
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &barrier);
+
+		int32_t nextWidth = std::max(mipWidth / 2, 1);
+		int32_t nextHeight = std::max(mipHeight / 2, 1);
+		VkImageBlit blit {
+			.srcSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = i - 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.srcOffsets = { { 0, 0, 0 }, { mipWidth, mipHeight, 1 } },
+			.dstSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = i,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			},
+			.dstOffsets = { { 0, 0, 0 }, { nextWidth, nextHeight, 1 } }
+		};
+		vkCmdBlitImage(commandBuffer,
+			image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit, VK_FILTER_LINEAR);
+		mipWidth = nextWidth;
+		mipHeight = nextHeight;
+	}
+
+	// all levels go to the shader in one call: 0..n-2 are blit sources, the last one is still a blit target
+	VkImageMemoryBarrier finalBarriers[2] = { barrier, barrier };
+	finalBarriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	finalBarriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	finalBarriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	finalBarriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	finalBarriers[0].subresourceRange.baseMipLevel = 0;
+	finalBarriers[0].subresourceRange.levelCount = mipLevels - 1;
+	finalBarriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	finalBarriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	finalBarriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	finalBarriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	finalBarriers[1].subresourceRange.baseMipLevel = mipLevels - 1;
+	finalBarriers[1].subresourceRange.levelCount = 1;
+	uint32_t barrierCount = mipLevels > 1 ? 2 : 1;
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		0, nullptr, 0, nullptr, barrierCount, mipLevels > 1 ? finalBarriers : &finalBarriers[1]);
+}
@@ -4,42 +4,59 @@
 #include <assert.h>
 #include <vector>
 
-VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+#include "allocator.h"
 
-VkCommandBuffer beginSingleTimeCommands(VkDevice device, VkCommandPool commandPool);
+VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+	uint32_t mipLevels);
 
-void endSingleTimeCommands(
-	VkDevice device, VkCommandPool commandPool,
-	VkQueue graphicsQueue, VkCommandBuffer commandBuffer);
+void createBuffer(VkDevice device, DeviceAllocator& allocator,
+	VkDeviceSize size, VkBufferUsageFlags usage, const MemoryUsage& memoryUsage,
+	VkBuffer& buffer, Allocation& bufferAllocation);
 
-uint32_t findMemoryType(
-	VkPhysicalDevice physicalDevice,
-	uint32_t typeFilter,
-	VkMemoryPropertyFlags properties);
+// false, with nothing created, when no memory type fits memoryUsage or there is no memory left
+bool tryCreateBuffer(VkDevice device, DeviceAllocator& allocator,
+	VkDeviceSize size, VkBufferUsageFlags usage, const MemoryUsage& memoryUsage,
+	VkBuffer& buffer, Allocation& bufferAllocation);
 
-void createBuffer(VkPhysicalDevice physDevice, VkDevice device,
-	VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-	VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+void destroyBuffer(VkDevice device, DeviceAllocator& allocator,
+	VkBuffer buffer, Allocation& bufferAllocation);
 
-void copyBuffer(
-	VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue,
-	VkBuffer src, VkBuffer dst, VkDeviceSize size);
-
-VkFormat findSupportedFormat(VkPhysicalDevice physDevice,
+VkFormat findSupportedFormat(const DeviceInfo& deviceInfo,
 	const std::vector<VkFormat>& candidates,
 	VkImageTiling tiling, VkFormatFeatureFlags features);
 
-VkFormat findDepthFormat(VkPhysicalDevice physDevice);
+VkFormat findDepthFormat(const DeviceInfo& deviceInfo);
 
 bool hasStencilComponent(VkFormat format);
 
-void createImage(VkPhysicalDevice physDevice, VkDevice device,
-	uint32_t width, uint32_t height,
+void createImage(VkDevice device, DeviceAllocator& allocator,
+	uint32_t width, uint32_t height, uint32_t mipLevels,
+	VkFormat format, VkImageTiling tiling,
+	VkImageUsageFlags usage, const MemoryUsage& memoryUsage,
+	VkImage& image, Allocation& imageAllocation);
+
+// false, with nothing created, when there is no device memory left for the image
+bool tryCreateImage(VkDevice device, DeviceAllocator& allocator,
+	uint32_t width, uint32_t height, uint32_t mipLevels,
 	VkFormat format, VkImageTiling tiling,
-	VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-	VkImage& image, VkDeviceMemory& imageMemory);
+	VkImageUsageFlags usage, const MemoryUsage& memoryUsage,
+	VkImage& image, Allocation& imageAllocation);
+
+void destroyImage(VkDevice device, DeviceAllocator& allocator,
+	VkImage image, Allocation& imageAllocation);
 
-void transitionImageLayout(
-	VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue,
+// records the barrier only; submission is up to the owner of commandBuffer
+void cmdTransitionImageLayout(VkCommandBuffer commandBuffer,
 	VkImage image, VkFormat format,
-	VkImageLayout oldLayout, VkImageLayout newLayout);
\ No newline at end of file
+	VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
+
+// whether vkCmdBlitImage with VK_FILTER_LINEAR can build mips of format
+bool supportsLinearBlit(const DeviceInfo& deviceInfo, VkFormat format);
+
+// whether images of format can be sampled with optimal tiling
+bool supportsSampledImage(const DeviceInfo& deviceInfo, VkFormat format);
+
+// builds levels 1..mipLevels-1 from level 0 with linear blits.
+// expects every level in TRANSFER_DST_OPTIMAL and leaves all of them in SHADER_READ_ONLY_OPTIMAL
+void cmdGenerateMipmaps(VkCommandBuffer commandBuffer, VkImage image,
+	uint32_t width, uint32_t height, uint32_t mipLevels);
@@ -0,0 +1,23 @@
+#include "vertex.h"
+#include "glm/gtc/packing.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+void packVertices(const Vertex* vertices, size_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+	PackedVertex* packed) {
+	// a flat axis (e.g. a quad) quantizes to 0 there instead of dividing by zero
+	glm::vec3 extent = boundsMax - boundsMin;
+	glm::vec3 invExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+		extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+		extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+	for (size_t i = 0; i < count; ++i) {
+		const Vertex& vertex = vertices[i];
+		// packUnorm clamps, so rounding at the bounds can't wrap around
+		packed[i].pos = glm::packUnorm4x16(glm::vec4((vertex.pos - boundsMin) * invExtent, 0.0f));
+		packed[i].color = glm::packUnorm4x8(glm::vec4(vertex.color, 1.0f));
+		packed[i].texcoord = glm::packHalf2x16(vertex.texcoord);
+	}
+}
+
+glm::mat4 packedPositionTransform(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	return glm::scale(glm::translate(glm::mat4(1.0f), boundsMin), boundsMax - boundsMin);
+}
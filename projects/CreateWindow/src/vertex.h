@@ -0,0 +1,81 @@
+#pragma once
+
+// warning level 4
+// glm uses nameless structs and unions
+#ifdef _MSC_VER
+#pragma warning(disable : 4201)
+#endif
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+#include "vulkan/vulkan.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// how a mesh's vertices are stored in its vertex buffer. Both feed the same shader inputs
+// (vec3 pos, vec3 color, vec2 texcoord); the packed formats are converted to float on fetch
+enum class VertexLayout {
+	// Vertex, 32 bytes
+	Float,
+	// PackedVertex, 16 bytes
+	Packed
+};
+
+// positions are 16-bit unorm within the mesh bounds, so the model matrix has to apply
+// packedPositionTransform(); the fourth component only pads, R16G16B16_UNORM isn't a required
+// vertex format while R16G16B16A16_UNORM, R8G8B8A8_UNORM and R16G16_SFLOAT are
+struct PackedVertex {
+	uint64_t pos;
+	// RGBA8 unorm, alpha is always 1
+	uint32_t color;
+	// two halfs
+	uint32_t texcoord;
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex is meant to be half of Vertex");
+
+struct Vertex {
+	glm::vec3 pos;
+	glm::vec3 color;
+	glm::vec2 texcoord;
+	static VkVertexInputBindingDescription getBindingDescription(VertexLayout layout = VertexLayout::Float) {
+		VkVertexInputBindingDescription desc{};
+		desc.binding = 0;
+		desc.stride = layout == VertexLayout::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+		desc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return desc;
+	}
+	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions(VertexLayout layout = VertexLayout::Float) {
+		std::array<VkVertexInputAttributeDescription, 3> desc;
+		desc[0].binding = 0;
+		desc[0].location = 0;
+		desc[1].binding = 0;
+		desc[1].location = 1;
+		desc[2].binding = 0;
+		desc[2].location = 2;
+		if (layout == VertexLayout::Packed) {
+			desc[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+			desc[0].offset = offsetof(PackedVertex, pos);
+			desc[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+			desc[1].offset = offsetof(PackedVertex, color);
+			desc[2].format = VK_FORMAT_R16G16_SFLOAT;
+			desc[2].offset = offsetof(PackedVertex, texcoord);
+			return desc;
+		}
+		desc[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		desc[0].offset = offsetof(Vertex, pos);
+		desc[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+		desc[1].offset = offsetof(Vertex, color);
+		desc[2].format = VK_FORMAT_R32G32_SFLOAT;
+		desc[2].offset = offsetof(Vertex, texcoord);
+		return desc;
+	}
+};
+
+// quantizes count vertices into packed; positions are taken relative to boundsMin..boundsMax,
+// which must contain them all
+void packVertices(const Vertex* vertices, size_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+	PackedVertex* packed);
+// maps packed positions (0..1 on each axis) back into the bounds they were quantized with
+glm::mat4 packedPositionTransform(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
@@ -0,0 +1,108 @@
+// Offline texture cooker: decodes source images once and writes .ctex files
+// (see CreateWindow/src/cookedtexture.h) that the renderer maps and uploads without decoding.
+#include "imageloader.h"
+#include "imagefilter.h"
+#include "compressedimage.h"
+#include "cookedtexture.h"
+#include "tilepyramid.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+static void printUsage(const char* program) {
+	std::cerr << "usage: " << program << " [--bc1 | --tiles] INPUT... \n"
+		<< "\t--bc1       store BC1 blocks instead of BGRA8 (opaque images only)\n"
+		<< "\t--tiles     write a tile pyramid (.tiles) for CreateWindow --tiled instead\n"
+		<< "\t-o FILE     output name, only with a single input\n"
+		<< "INPUT.jpg/.png is written next to the input as INPUT.ctex or INPUT.tiles" << std::endl;
+}
+
+static std::string outputName(const std::string& input, const char* extension) {
+	size_t dot = input.find_last_of('.');
+	size_t slash = input.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+		return input + extension;
+	}
+	return input.substr(0, dot) + extension;
+}
+
+static bool cook(const std::string& input, const std::string& output, bool bc1) {
+	freeimage::ImageData imageData = freeimage::loadImage(input.c_str());
+	if (!imageData.isValid()) {
+		return false;
+	}
+	uint32_t width = static_cast<uint32_t>(imageData.width);
+	uint32_t height = static_cast<uint32_t>(imageData.height);
+	uint32_t mipLevels = mipLevelCount(width, height);
+
+	// the same texel order the runtime uploads from FreeImage, so cooked and uncooked textures look alike
+	std::vector<std::vector<unsigned char>> bgraLevels(mipLevels);
+	bgraLevels[0].resize(static_cast<size_t>(width) * height * 4);
+	imageData.copyTo(bgraLevels[0].data(), static_cast<size_t>(width) * 4);
+	imageData.unload();
+	for (uint32_t level = 1; level < mipLevels; ++level) {
+		uint32_t parentWidth = std::max(width >> (level - 1), 1u);
+		uint32_t parentHeight = std::max(height >> (level - 1), 1u);
+		bgraLevels[level].resize(static_cast<size_t>(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4);
+		downsampleBox(bgraLevels[level - 1].data(), parentWidth, parentHeight, bgraLevels[level].data());
+	}
+
+	VkFormat format = VK_FORMAT_B8G8R8A8_UNORM;
+	if (bc1) {
+		format = VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		for (uint32_t level = 0; level < mipLevels; ++level) {
+			uint32_t levelWidth = std::max(width >> level, 1u);
+			uint32_t levelHeight = std::max(height >> level, 1u);
+			std::vector<unsigned char> blocks(static_cast<size_t>((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * 8);
+			compressLevelBC1(bgraLevels[level].data(), levelWidth, levelHeight, blocks.data());
+			bgraLevels[level] = std::move(blocks);
+		}
+	}
+
+	if (!writeCookedTexture(output.c_str(), format, width, height, bgraLevels)) {
+		return false;
+	}
+	std::cout << input << " -> " << output << " (" << width << "x" << height << ", "
+		<< mipLevels << " levels, " << (bc1 ? "BC1" : "BGRA8") << ")" << std::endl;
+	return true;
+}
+
+int main(int argc, char** argv) {
+	bool bc1 = false;
+	bool tiles = false;
+	std::string output;
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--bc1") == 0) {
+			bc1 = true;
+		} else if (strcmp(argv[i], "--tiles") == 0) {
+			tiles = true;
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			output = argv[++i];
+		} else if (argv[i][0] == '-') {
+			printUsage(argv[0]);
+			return 1;
+		} else {
+			inputs.push_back(argv[i]);
+		}
+	}
+	if (inputs.empty() || (!output.empty() && inputs.size() > 1) || (bc1 && tiles)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	int failed = 0;
+	for (const std::string& input : inputs) {
+		std::string name = output.empty() ? outputName(input, tiles ? ".tiles" : ".ctex") : output;
+		bool cooked = tiles ? buildTilePyramid(input.c_str(), name.c_str()) : cook(input, name, bc1);
+		if (!cooked) {
+			std::cerr << "failed to cook " << input << std::endl;
+			++failed;
+		} else if (tiles) {
+			std::cout << input << " -> " << name << std::endl;
+		}
+	}
+	return failed == 0 ? 0 : 1;
+}